@@ -0,0 +1,588 @@
+#include "bench.h"
+#include "objects.h"
+#include "spatial.h"
+#include "collision.h"
+#include "player.h"
+#include "sprite.h"
+#include "game.h"
+#include "minimap.h"
+#include "pack.h"
+#include <SDL/SDL_image.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_ENTITIES 10000
+#define BENCH_TICKS    1000
+
+#define BENCH_STATIC   4000
+#define BENCH_MOVING   1000
+#define BENCH_QUERIES  1000   // Player-sized probes per tick
+#define BENCH_HASH_TICKS 100
+
+#define BENCH_BODIES   500    // Player-sized boxes falling through a field of ledges
+#define BENCH_LEDGES   1500
+#define BENCH_FALL_TICKS 200
+
+#define BENCH_DOWNSAMPLE_RUNS 50
+
+#define BENCH_FRAMES       500   // Background redraws per method
+#define BENCH_STARTUP_RUNS 10
+
+static double now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+// The GameObject layout update_objects() used before the SoA store
+typedef struct {
+    SDL_Surface* sprite;
+    SDL_Rect position;
+    SDL_Rect prev_position;
+    int active;
+    int frame;
+    int max_frame;
+    int velocityX;
+    int leftLimit;
+    int rightLimit;
+} AosObject;
+
+static void update_aos(AosObject* objs, int n, int animate) {
+    for (int i = 0; i < n; i++) {
+        AosObject* o = &objs[i];
+        if (!o->active) continue;
+        if (animate && o->max_frame > 1)
+            o->frame = (o->frame + 1) % o->max_frame;
+        o->position.x += o->velocityX;
+        if (o->position.x <= o->leftLimit || o->position.x + o->position.w >= o->rightLimit) {
+            o->velocityX = -o->velocityX;
+        }
+    }
+}
+
+// 10k patrolling obstacles and animated coins, advanced BENCH_TICKS times
+// per-object through the old struct layout and batched through the SoA
+// kernels. Both runs must end in the same state.
+static int bench_entities() {
+    int n = BENCH_ENTITIES;
+    AosObject* aos = calloc(n, sizeof(AosObject));
+    Sint32* x     = malloc(n * sizeof(Sint32));
+    Sint32* vx    = malloc(n * sizeof(Sint32));
+    Sint32* w     = malloc(n * sizeof(Sint32));
+    Sint32* left  = malloc(n * sizeof(Sint32));
+    Sint32* right = malloc(n * sizeof(Sint32));
+    Sint32* frame = malloc(n * sizeof(Sint32));
+    Sint32* maxf  = malloc(n * sizeof(Sint32));
+    if (!aos || !x || !vx || !w || !left || !right || !frame || !maxf) {
+        fprintf(stderr, "bench: out of memory\n");
+        return 1;
+    }
+
+    srand(1234);
+    for (int i = 0; i < n; i++) {
+        int coin = (i % 4 == 0);
+        AosObject* o = &aos[i];
+        o->active = 1;
+        o->position.x = (Sint16)(rand() % 20000);
+        o->position.w = coin ? 32 : 50;
+        o->velocityX = coin ? 0 : 1 + rand() % 3;
+        o->leftLimit = o->position.x - 75;
+        o->rightLimit = o->position.x + 170;
+        o->max_frame = coin ? 4 : 1;
+
+        x[i] = o->position.x;
+        w[i] = o->position.w;
+        vx[i] = o->velocityX;
+        left[i] = o->leftLimit;
+        right[i] = o->rightLimit;
+        frame[i] = 0;
+        maxf[i] = o->max_frame;
+    }
+
+    double t0 = now_ms();
+    for (int t = 0; t < BENCH_TICKS; t++)
+        update_aos(aos, n, t % 6 == 0);
+    double aos_ms = now_ms() - t0;
+
+    t0 = now_ms();
+    for (int t = 0; t < BENCH_TICKS; t++) {
+        if (t % 6 == 0) animate_entities(frame, maxf, n);
+        patrol_entities(x, vx, w, left, right, n);
+    }
+    double soa_ms = now_ms() - t0;
+
+    int mismatches = 0;
+    for (int i = 0; i < n; i++) {
+        if (aos[i].position.x != x[i] || aos[i].velocityX != vx[i] || aos[i].frame != frame[i])
+            mismatches++;
+    }
+
+    printf("entities: %d x %d ticks\n", n, BENCH_TICKS);
+    printf("  AoS per-object: %8.4f ms/tick\n", aos_ms / BENCH_TICKS);
+    printf("  SoA batched:    %8.4f ms/tick (%.1fx)\n", soa_ms / BENCH_TICKS,
+           soa_ms > 0 ? aos_ms / soa_ms : 0.0);
+    printf("  results %s\n", mismatches ? "DIFFER" : "match");
+
+    free(aos); free(x); free(vx); free(w); free(left); free(right);
+    free(frame); free(maxf);
+    return mismatches ? 1 : 0;
+}
+
+static SDL_Rect random_rect(int world_w, int world_h, int min_size, int max_size) {
+    SDL_Rect r;
+    r.w = (Uint16)(min_size + rand() % (max_size - min_size + 1));
+    r.h = (Uint16)(min_size + rand() % (max_size - min_size + 1));
+    r.x = (Sint16)(rand() % (world_w - r.w));
+    r.y = (Sint16)(rand() % (world_h - r.h));
+    return r;
+}
+
+// Thousands of static and moving colliders probed by player-sized rects,
+// once by testing every collider and once through a spatial hash rebuilt
+// every tick. Both must find the same overlaps.
+static int bench_spatial() {
+    enum { WORLD_W = 16000, WORLD_H = 2000 };
+    int n = BENCH_STATIC + BENCH_MOVING;
+    SDL_Rect* colliders = malloc(n * sizeof(SDL_Rect));
+    int* vx = calloc(n, sizeof(int));
+    SDL_Rect* probes = malloc(BENCH_QUERIES * sizeof(SDL_Rect));
+    int* near = malloc(n * sizeof(int));
+    SpatialHash hash;
+    if (!colliders || !vx || !probes || !near ||
+        !spatial_init(&hash, WORLD_CELL_SHIFT, 8192, n, n * 16)) {
+        fprintf(stderr, "bench: out of memory\n");
+        return 1;
+    }
+
+    srand(4321);
+    for (int i = 0; i < n; i++) {
+        colliders[i] = random_rect(WORLD_W - 200, WORLD_H, 16, 96);
+        if (i >= BENCH_STATIC) vx[i] = (rand() % 2) ? 2 : -2;
+    }
+    for (int q = 0; q < BENCH_QUERIES; q++)
+        probes[q] = random_rect(WORLD_W, WORLD_H, 50, 100);
+
+    long brute_hits = 0, hash_hits = 0;
+    double brute_ms = 0, hash_ms = 0;
+    for (int t = 0; t < BENCH_HASH_TICKS; t++) {
+        for (int i = BENCH_STATIC; i < n; i++) {
+            colliders[i].x += vx[i];
+            if (colliders[i].x <= 0 || colliders[i].x >= WORLD_W - 200) vx[i] = -vx[i];
+        }
+
+        double t0 = now_ms();
+        for (int q = 0; q < BENCH_QUERIES; q++) {
+            for (int i = 0; i < n; i++)
+                brute_hits += check_collision(probes[q], colliders[i]);
+        }
+        brute_ms += now_ms() - t0;
+
+        t0 = now_ms();
+        spatial_clear(&hash);
+        for (int i = 0; i < n; i++)
+            spatial_insert(&hash, i, colliders[i]);
+        for (int q = 0; q < BENCH_QUERIES; q++) {
+            int m = spatial_query(&hash, probes[q], near, n);
+            for (int k = 0; k < m; k++)
+                hash_hits += check_collision(probes[q], colliders[near[k]]);
+        }
+        hash_ms += now_ms() - t0;
+    }
+
+    printf("spatial: %d static + %d moving colliders, %d probes x %d ticks\n",
+           BENCH_STATIC, BENCH_MOVING, BENCH_QUERIES, BENCH_HASH_TICKS);
+    printf("  brute force:  %8.4f ms/tick\n", brute_ms / BENCH_HASH_TICKS);
+    printf("  spatial hash: %8.4f ms/tick incl. rebuild (%.1fx)\n", hash_ms / BENCH_HASH_TICKS,
+           hash_ms > 0 ? brute_ms / hash_ms : 0.0);
+    printf("  overlaps %s (%ld)\n", brute_hits == hash_hits ? "match" : "DIFFER", brute_hits);
+
+    spatial_free(&hash);
+    free(colliders); free(vx); free(probes); free(near);
+    return brute_hits == hash_hits ? 0 : 1;
+}
+
+typedef struct {
+    FixRect box;
+    FixRect spawn;      // Clear of every ledge
+    fixed_t vx, vy;
+} FallingBody;
+
+// The per-solid overlap resolution update_player() used before the
+// swept resolver: move first, then push out along the shallower axis
+static void resolve_discrete(FallingBody* b, const FixRect* solids, int n) {
+    b->box.x += b->vx;
+    b->box.y += b->vy;
+    for (int i = 0; i < n; i++) {
+        FixRect s = solids[i];
+        if (b->box.x + b->box.w < s.x || b->box.x > s.x + s.w ||
+            b->box.y + b->box.h < s.y || b->box.y > s.y + s.h) continue;
+        fixed_t overlapLeft = (b->box.x + b->box.w) - s.x;
+        fixed_t overlapRight = (s.x + s.w) - b->box.x;
+        fixed_t overlapTop = (b->box.y + b->box.h) - s.y;
+        fixed_t overlapBottom = (s.y + s.h) - b->box.y;
+        fixed_t xOverlap = (overlapLeft < overlapRight) ? overlapLeft : overlapRight;
+        fixed_t yOverlap = (overlapTop < overlapBottom) ? overlapTop : overlapBottom;
+        if (xOverlap < yOverlap) {
+            b->box.x = (overlapLeft < overlapRight) ? s.x - b->box.w : s.x + s.w;
+        } else if (overlapTop < overlapBottom) {
+            b->box.y = s.y - b->box.h;
+            b->vy = 0;
+        } else {
+            b->box.y = s.y + s.h;
+            b->vy = 0;
+        }
+    }
+}
+
+static void resolve_swept(FallingBody* b, const FixRect* solids, int n) {
+    Contact contacts[MAX_CONTACTS];
+    int hits = resolve_motion(&b->box, b->vx, b->vy, solids, n, contacts, MAX_CONTACTS);
+    for (int c = 0; c < hits; c++) {
+        if (contacts[c].normal_y) b->vy = 0;
+    }
+}
+
+// Ledges the body was fully above before the step but isn't above after,
+// while overlapping it horizontally: it went into or through the ledge
+static int count_fall_through(FixRect before, FixRect after, const FixRect* solids, int n) {
+    int count = 0;
+    for (int i = 0; i < n; i++) {
+        FixRect s = solids[i];
+        if (before.y + before.h > s.y || after.y + after.h <= s.y) continue;
+        if (after.x + after.w <= s.x || after.x >= s.x + s.w) continue;
+        count++;
+    }
+    return count;
+}
+
+static int run_falling(void (*resolve)(FallingBody*, const FixRect*, int), const FixRect* ledges,
+                       FallingBody* bodies, double* ms) {
+    int fall_through = 0;
+    double spent = 0;
+    for (int t = 0; t < BENCH_FALL_TICKS; t++) {
+        for (int b = 0; b < BENCH_BODIES; b++) {
+            FallingBody* body = &bodies[b];
+            body->vy += GRAVITY;
+            if (body->vy > MAX_FALL_SPEED) body->vy = MAX_FALL_SPEED;
+            // Keep hopping so bodies keep meeting new ledges
+            if (body->vy == 0 && t % 20 == 0) body->vy = INT_TO_FIX(-15);
+
+            FixRect before = body->box;
+            double t0 = now_ms();
+            resolve(body, ledges, BENCH_LEDGES);
+            spent += now_ms() - t0;
+            fall_through += count_fall_through(before, body->box, ledges, BENCH_LEDGES);
+
+            if (body->box.y > INT_TO_FIX(3900)) body->box = body->spawn;
+            if (body->box.x < 0 || body->box.x > INT_TO_FIX(3900)) body->vx = -body->vx;
+        }
+    }
+    *ms = spent;
+    return fall_through;
+}
+
+// FNV-1a over the final body states, to compare runs
+static Uint32 bodies_checksum(const FallingBody* bodies, int n) {
+    const Uint8* p = (const Uint8*)bodies;
+    Uint32 h = 2166136261u;
+    for (size_t i = 0; i < n * sizeof(FallingBody); i++)
+        h = (h ^ p[i]) * 16777619u;
+    return h;
+}
+
+// Player-sized bodies falling at up to MAX_FALL_SPEED through thin ledges,
+// resolved by the old move-then-push-out code and by the swept resolver.
+// Bodies walk at a fractional speed so sub-pixel motion is exercised.
+static int bench_collision() {
+    FixRect* ledges = malloc(BENCH_LEDGES * sizeof(FixRect));
+    FallingBody* start = malloc(BENCH_BODIES * sizeof(FallingBody));
+    FallingBody* bodies = malloc(BENCH_BODIES * sizeof(FallingBody));
+    if (!ledges || !start || !bodies) {
+        fprintf(stderr, "bench: out of memory\n");
+        return 1;
+    }
+
+    srand(9876);
+    for (int i = 0; i < BENCH_LEDGES; i++) {
+        SDL_Rect r = random_rect(4000, 4000, 80, 80);
+        r.h = 10;
+        ledges[i] = fix_rect(r);
+    }
+    memset(start, 0, BENCH_BODIES * sizeof(FallingBody));
+    for (int b = 0; b < BENCH_BODIES; b++) {
+        SDL_Rect r;
+        int clear;
+        do {
+            r = random_rect(3900, 200, 40, 40);
+            r.h = 60;
+            clear = 1;
+            for (int i = 0; i < BENCH_LEDGES && clear; i++)
+                clear = !check_collision(r, fix_to_rect(ledges[i]));
+        } while (!clear);
+        start[b].box = start[b].spawn = fix_rect(r);
+        start[b].vx = ((rand() % 2) ? 1 : -1) * (PLAYER_SPEED - FIX_ONE / 3);
+        start[b].vy = 0;
+    }
+
+    double discrete_ms, swept_ms, rerun_ms;
+    memcpy(bodies, start, BENCH_BODIES * sizeof(FallingBody));
+    int discrete_bad = run_falling(resolve_discrete, ledges, bodies, &discrete_ms);
+    memcpy(bodies, start, BENCH_BODIES * sizeof(FallingBody));
+    int swept_bad = run_falling(resolve_swept, ledges, bodies, &swept_ms);
+    Uint32 first = bodies_checksum(bodies, BENCH_BODIES);
+    memcpy(bodies, start, BENCH_BODIES * sizeof(FallingBody));
+    run_falling(resolve_swept, ledges, bodies, &rerun_ms);
+    Uint32 second = bodies_checksum(bodies, BENCH_BODIES);
+
+    printf("collision: %d bodies x %d ticks against %d ledges\n",
+           BENCH_BODIES, BENCH_FALL_TICKS, BENCH_LEDGES);
+    printf("  move + push out: %8.4f ms/tick, %d fall-throughs\n",
+           discrete_ms / BENCH_FALL_TICKS, discrete_bad);
+    printf("  swept AABB:      %8.4f ms/tick, %d fall-throughs\n",
+           swept_ms / BENCH_FALL_TICKS, swept_bad);
+    printf("  rerun %s (state %08x)\n", first == second ? "identical" : "DIFFERS", (unsigned)first);
+
+    free(ledges); free(start); free(bodies);
+    return swept_bad == 0 && first == second ? 0 : 1;
+}
+
+// Minimap-sized box filter over a level-sized surface, straight per-pixel
+// loops against sprite_downsampled()
+static int bench_downsample() {
+    const int fx = WORLD_WIDTH / MINIMAP_WIDTH, fy = SCREEN_HEIGHT / MINIMAP_HEIGHT;
+    SDL_Surface* world = SDL_CreateRGBSurface(SDL_SWSURFACE, WORLD_WIDTH, SCREEN_HEIGHT, 32,
+                                              0x00FF0000, 0x0000FF00, 0x000000FF, 0);
+    Uint8* naive = malloc(MINIMAP_WIDTH * MINIMAP_HEIGHT * 4);
+    if (!world || !naive) {
+        fprintf(stderr, "bench: out of memory\n");
+        return 1;
+    }
+    srand(2468);
+    for (int y = 0; y < world->h; y++) {
+        Uint8* row = (Uint8*)world->pixels + y * world->pitch;
+        for (int i = 0; i < world->w * 4; i++) row[i] = (Uint8)rand();
+    }
+
+    double start = now_ms();
+    for (int run = 0; run < BENCH_DOWNSAMPLE_RUNS; run++) {
+        for (int oy = 0; oy < MINIMAP_HEIGHT; oy++) {
+            for (int ox = 0; ox < MINIMAP_WIDTH; ox++) {
+                for (int b = 0; b < 4; b++) {
+                    Uint32 sum = 0;
+                    for (int y = oy * fy; y < (oy + 1) * fy; y++) {
+                        const Uint8* row = (const Uint8*)world->pixels + y * world->pitch;
+                        for (int x = ox * fx; x < (ox + 1) * fx; x++) sum += row[x * 4 + b];
+                    }
+                    naive[(oy * MINIMAP_WIDTH + ox) * 4 + b] = (Uint8)((sum + fx * fy / 2) / (fx * fy));
+                }
+            }
+        }
+    }
+    double naive_ms = now_ms() - start;
+
+    SDL_Surface* mini = NULL;
+    start = now_ms();
+    for (int run = 0; run < BENCH_DOWNSAMPLE_RUNS; run++) {
+        if (mini) SDL_FreeSurface(mini);
+        mini = sprite_downsampled(world, fx, fy);
+    }
+    double box_ms = now_ms() - start;
+
+    int mismatches = 0;
+    for (int y = 0; mini && y < MINIMAP_HEIGHT; y++) {
+        if (memcmp((Uint8*)mini->pixels + y * mini->pitch, naive + y * MINIMAP_WIDTH * 4, MINIMAP_WIDTH * 4))
+            mismatches++;
+    }
+
+    printf("downsample: %dx%d to %dx%d, %d runs\n", WORLD_WIDTH, SCREEN_HEIGHT,
+           MINIMAP_WIDTH, MINIMAP_HEIGHT, BENCH_DOWNSAMPLE_RUNS);
+    printf("  per pixel:          %8.4f ms\n", naive_ms / BENCH_DOWNSAMPLE_RUNS);
+    printf("  sprite_downsampled: %8.4f ms (%.1fx)\n", box_ms / BENCH_DOWNSAMPLE_RUNS,
+           box_ms > 0 ? naive_ms / box_ms : 0.0);
+    printf("  results %s\n", mini && !mismatches ? "match" : "DIFFER");
+
+    if (mini) SDL_FreeSurface(mini);
+    SDL_FreeSurface(world);
+    free(naive);
+    return mini && !mismatches ? 0 : 1;
+}
+
+// Pixels of a 32-bit screen that differ from a saved copy. The byte the
+// screen format doesn't use is left out; conversions don't agree on it.
+static int count_mismatches(const Uint8* saved, SDL_Surface* screen) {
+    Uint32 used = screen->format->Rmask | screen->format->Gmask | screen->format->Bmask;
+    int mismatches = 0;
+    for (int y = 0; y < screen->h; y++) {
+        const Uint32* a = (const Uint32*)(saved + y * screen->w * 4);
+        const Uint32* b = (const Uint32*)((Uint8*)screen->pixels + y * screen->pitch);
+        for (int x = 0; x < screen->w; x++) {
+            if ((a[x] ^ b[x]) & used) mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+// One screen's background the way update_game() drew it every frame, three
+// display-format layers on top of each other, against one blit of the
+// level compose_level() flattens once. Both must put the same pixels up.
+static int bench_background() {
+    static const char* const paths[3] = {"assets/sky1.jpg", "assets/city1.png", "assets/ground1.png"};
+    static const int ys[3] = {0, 0, GROUND_LEVEL};
+
+    SDL_Surface* screen = SDL_CreateRGBSurface(SDL_SWSURFACE, SCREEN_WIDTH, SCREEN_HEIGHT, 32,
+                                               PACK_RMASK, PACK_GMASK, PACK_BMASK, 0);
+    Uint8* layered = malloc((size_t)SCREEN_WIDTH * SCREEN_HEIGHT * 4);
+    if (!screen || !layered) {
+        fprintf(stderr, "bench: out of memory\n");
+        return 1;
+    }
+    SDL_Surface* layers[3];
+    for (int i = 0; i < 3; i++) {
+        SDL_Surface* tmp = IMG_Load(paths[i]);
+        if (!tmp) {
+            fprintf(stderr, "bench: failed to load %s: %s\n", paths[i], IMG_GetError());
+            return 1;
+        }
+        layers[i] = SDL_ConvertSurface(tmp, screen->format, SDL_SWSURFACE);   // As SDL_DisplayFormat
+        SDL_FreeSurface(tmp);
+    }
+
+    double start = now_ms();
+    for (int f = 0; f < BENCH_FRAMES; f++) {
+        for (int i = 0; i < 3; i++) {
+            SDL_Rect pos = {0, (Sint16)ys[i], 0, 0};
+            SDL_BlitSurface(layers[i], NULL, screen, &pos);
+        }
+    }
+    double layered_ms = now_ms() - start;
+    for (int y = 0; y < SCREEN_HEIGHT; y++)
+        memcpy(layered + y * SCREEN_WIDTH * 4, (Uint8*)screen->pixels + y * screen->pitch, SCREEN_WIDTH * 4);
+
+    SDL_Surface* saved = game.screen;
+    game.screen = screen;   // compose_level() builds in the screen's format
+    SDL_Surface* composed = compose_level(0);
+    game.screen = saved;
+    if (!composed) return 1;
+    SDL_FillRect(screen, NULL, 0);
+
+    start = now_ms();
+    for (int f = 0; f < BENCH_FRAMES; f++)
+        SDL_BlitSurface(composed, NULL, screen, NULL);
+    double composed_ms = now_ms() - start;
+
+    int mismatches = count_mismatches(layered, screen);
+
+    printf("background: %dx%d, %d frames\n", SCREEN_WIDTH, SCREEN_HEIGHT, BENCH_FRAMES);
+    printf("  three layers: %8.4f ms/frame\n", layered_ms / BENCH_FRAMES);
+    printf("  composed:     %8.4f ms/frame (%.1fx)\n", composed_ms / BENCH_FRAMES,
+           composed_ms > 0 ? layered_ms / composed_ms : 0.0);
+    printf("  results %s\n", mismatches ? "DIFFER" : "match");
+
+    for (int i = 0; i < 3; i++) SDL_FreeSurface(layers[i]);
+    SDL_FreeSurface(composed);
+    SDL_FreeSurface(screen);
+    free(layered);
+    return mismatches ? 1 : 0;
+}
+
+// Images the game needs before its first frame, besides the level
+static const char* const startup_images[] = {
+    "assets/player.png", "assets/platform.png", "assets/coin.png", "assets/obstacle.jpg",
+    "assets/minimap_player.jpg", "assets/minimap_platform.png", "assets/minimap_coin.png",
+};
+#define STARTUP_IMAGES (int)(sizeof(startup_images) / sizeof(startup_images[0]))
+
+// Everything up to the first frame of level 1, decoded and converted from
+// the loose files, against mapped from the archive with the level drawn
+// from its tiles. Files are in the page cache after the first run, so this
+// times the CPU side of startup, not the disk.
+static int bench_startup() {
+    SDL_Surface* screen = SDL_CreateRGBSurface(SDL_SWSURFACE, SCREEN_WIDTH, SCREEN_HEIGHT, 32,
+                                               PACK_RMASK, PACK_GMASK, PACK_BMASK, 0);
+    Uint8* loose_frame = malloc((size_t)SCREEN_WIDTH * SCREEN_HEIGHT * 4);
+    if (!screen || !loose_frame) {
+        fprintf(stderr, "bench: out of memory\n");
+        return 1;
+    }
+    SDL_Surface* saved = game.screen;
+    game.screen = screen;
+    SDL_Surface* images[STARTUP_IMAGES];
+
+    double start = now_ms();
+    for (int run = 0; run < BENCH_STARTUP_RUNS; run++) {
+        for (int i = 0; i < STARTUP_IMAGES; i++) {
+            SDL_Surface* tmp = IMG_Load(startup_images[i]);
+            images[i] = tmp ? SDL_ConvertSurface(tmp, screen->format, SDL_SWSURFACE) : NULL;
+            if (tmp) SDL_FreeSurface(tmp);
+        }
+        SDL_Surface* level = compose_level(0);
+        if (level) SDL_BlitSurface(level, NULL, screen, NULL);
+        SDL_FreeSurface(level);
+        for (int i = 0; i < STARTUP_IMAGES; i++) SDL_FreeSurface(images[i]);
+    }
+    double loose_ms = now_ms() - start;
+    for (int y = 0; y < SCREEN_HEIGHT; y++)
+        memcpy(loose_frame + y * SCREEN_WIDTH * 4, (Uint8*)screen->pixels + y * screen->pitch, SCREEN_WIDTH * 4);
+    SDL_FillRect(screen, NULL, 0);
+
+    int missing = 0;
+    start = now_ms();
+    for (int run = 0; run < BENCH_STARTUP_RUNS; run++) {
+        if (!init_pack(PACK_PATH)) {
+            fprintf(stderr, "bench: no %s, run the packer first\n", PACK_PATH);
+            game.screen = saved;
+            return 1;
+        }
+        for (int i = 0; i < STARTUP_IMAGES; i++) {
+            images[i] = pack_display_surface(startup_images[i], screen->format);
+            if (!images[i]) missing++;
+        }
+        char name[PACK_NAME_LEN];
+        int cols, rows, pitch;
+        snprintf(name, sizeof(name), PACK_MAP_NAME, 1);
+        SDL_Surface* tileset = pack_surface(PACK_TILESET_NAME);
+        const Uint16* grid = pack_tilemap(name, &cols, &rows, &pitch);
+        for (int row = 0; tileset && grid && row < rows; row++) {
+            for (int col = 0; col * TILE_SIZE < SCREEN_WIDTH && col < cols; col++) {
+                int tile = grid[row * pitch + col];
+                SDL_Rect src = {(Sint16)(tile % TILESET_COLS * TILE_SIZE),
+                                (Sint16)(tile / TILESET_COLS * TILE_SIZE), TILE_SIZE, TILE_SIZE};
+                SDL_Rect pos = {(Sint16)(col * TILE_SIZE), (Sint16)(row * TILE_SIZE), 0, 0};
+                SDL_BlitSurface(tileset, &src, screen, &pos);
+            }
+        }
+        if (tileset) SDL_FreeSurface(tileset);
+        for (int i = 0; i < STARTUP_IMAGES; i++) SDL_FreeSurface(images[i]);
+        cleanup_pack();
+    }
+    double packed_ms = now_ms() - start;
+    game.screen = saved;
+
+    int mismatches = count_mismatches(loose_frame, screen);
+
+    printf("startup: %d images and level 1 to its first frame, %d runs\n", STARTUP_IMAGES, BENCH_STARTUP_RUNS);
+    printf("  loose files: %8.3f ms\n", loose_ms / BENCH_STARTUP_RUNS);
+    printf("  archive:     %8.3f ms (%.1fx)\n", packed_ms / BENCH_STARTUP_RUNS,
+           packed_ms > 0 ? loose_ms / packed_ms : 0.0);
+    printf("  first frame %s%s\n", mismatches ? "DIFFERS" : "matches", missing ? ", images missing from the archive" : "");
+
+    SDL_FreeSurface(screen);
+    free(loose_frame);
+    return mismatches || missing ? 1 : 0;
+}
+
+// Runs the named microbenchmark and returns a process exit code
+int run_benchmark(const char* name) {
+    if (strcmp(name, "entities") == 0) return bench_entities();
+    if (strcmp(name, "spatial") == 0) return bench_spatial();
+    if (strcmp(name, "collision") == 0) return bench_collision();
+    if (strcmp(name, "downsample") == 0) return bench_downsample();
+    if (strcmp(name, "background") == 0) return bench_background();
+    if (strcmp(name, "startup") == 0) return bench_startup();
+
+    fprintf(stderr, "Unknown benchmark '%s'. Available: entities, spatial, collision, downsample, "
+            "background, startup\n", name);
+    return 1;
+}
@@ -0,0 +1,29 @@
+#include "camera.h"
+#include "game.h"
+#include "dirty.h"
+
+SDL_Rect camera = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
+
+// Centers the view on target, clamped to the level. Any scroll moves every
+// pixel on screen, so it forces a full redraw.
+void camera_follow(SDL_Rect target) {
+    int x = target.x + target.w / 2 - SCREEN_WIDTH / 2;
+    if (x > WORLD_WIDTH - SCREEN_WIDTH) x = WORLD_WIDTH - SCREEN_WIDTH;
+    if (x < 0) x = 0;
+    if (x != camera.x) {
+        camera.x = (Sint16)x;
+        dirty_invalidate();
+    }
+}
+
+// Whether any of world rect r is on screen
+int camera_visible(SDL_Rect r) {
+    return r.x < camera.x + camera.w && r.x + r.w > camera.x &&
+           r.y < camera.y + camera.h && r.y + r.h > camera.y;
+}
+
+SDL_Rect camera_to_screen(SDL_Rect r) {
+    r.x -= camera.x;
+    r.y -= camera.y;
+    return r;
+}
@@ -0,0 +1,14 @@
+#ifndef CAMERA_H
+#define CAMERA_H
+
+#include <SDL/SDL.h>
+
+// The part of the world on screen, in world pixels. Levels are wider than
+// the screen and only scroll horizontally, so y stays 0.
+extern SDL_Rect camera;
+
+void     camera_follow(SDL_Rect target);
+int      camera_visible(SDL_Rect r);
+SDL_Rect camera_to_screen(SDL_Rect r);
+
+#endif
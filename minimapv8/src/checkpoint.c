@@ -0,0 +1,129 @@
+#include "checkpoint.h"
+#include "save.h"
+#include "input.h"
+#include <stdio.h>
+#include <string.h>
+
+static Checkpoint ring[CHECKPOINT_RING];
+static int        ring_head  = 0;   // Next slot to write
+static int        ring_count = 0;
+static int        enabled    = 0;
+static int        ticks_since_capture = 0;
+static int        captured_level = -1;
+
+// Simulations, recordings and replays leave the player's files alone
+static int persist() {
+    return !game.headless && !input_replaying() && !input_recording();
+}
+
+// Picks up where the last session's autosave left off
+static void resume_from_disk() {
+    SaveData d;
+    if (!save_read(CHECKPOINT_PATH, &d)) return;
+    game.health = d.health > 0 ? d.health : MAX_HEALTH;
+    game.score = d.score;
+    memcpy(game.collected_coins, d.collected_coins, sizeof(game.collected_coins));
+    place_player(&player, INT_TO_FIX(d.x), INT_TO_FIX(d.y));
+    load_level(d.level);
+    printf("Resumed from %s\n", CHECKPOINT_PATH);
+}
+
+void init_checkpoints() {
+    ring_head = 0;
+    ring_count = 0;
+    enabled = 1;
+    if (persist()) resume_from_disk();
+    checkpoint_capture();
+}
+
+// Snapshots the current state into the ring and hands a copy to the save
+// thread; nothing here touches the disk.
+void checkpoint_capture() {
+    if (!enabled) return;
+
+    Checkpoint* c = &ring[ring_head];
+    c->player_body = player.body;
+    c->facing_right = player.facing_right;
+    c->health = game.health;
+    c->score = game.score;
+    c->level = current_level;
+    memcpy(c->collected_coins, game.collected_coins, sizeof(c->collected_coins));
+    c->moving_count = 0;
+    for (int i = 0; i < entities.count; i++) {
+        if (entities.velocityX[i] == 0) continue;
+        c->moving[c->moving_count].spawn_id = entities.spawn_id[i];
+        c->moving[c->moving_count].x = entities.x[i];
+        c->moving[c->moving_count].velocityX = entities.velocityX[i];
+        c->moving_count++;
+    }
+
+    ring_head = (ring_head + 1) % CHECKPOINT_RING;
+    if (ring_count < CHECKPOINT_RING) ring_count++;
+    ticks_since_capture = 0;
+    captured_level = current_level;
+
+    if (!persist()) return;
+
+    SaveData d;
+    d.x = FIX_TO_INT(c->player_body.x);
+    d.y = FIX_TO_INT(c->player_body.y);
+    d.coin_active = !c->collected_coins[c->level];
+    d.health = c->health;
+    d.score = c->score;
+    d.level = c->level;
+    memcpy(d.collected_coins, c->collected_coins, sizeof(d.collected_coins));
+    save_write_async(CHECKPOINT_PATH, &d);
+}
+
+static int safe_to_capture() {
+    if (player.jumping || game.health <= 0) return 0;
+    for (int i = 0; i < entities.count; i++) {
+        if ((entities.type[i] == ENTITY_PLATFORM || entities.type[i] == ENTITY_OBSTACLE) &&
+            check_collision(player.position, entity_rect(i)))
+            return 0;
+    }
+    return 1;
+}
+
+// Called once per simulation tick. Captures when the player first stands
+// somewhere safe in a new level, and every CHECKPOINT_INTERVAL ticks.
+void checkpoint_tick() {
+    if (!enabled) return;
+    ticks_since_capture++;
+    if ((current_level != captured_level || ticks_since_capture >= CHECKPOINT_INTERVAL) &&
+        safe_to_capture()) {
+        checkpoint_capture();
+    }
+}
+
+// Puts the game back to the latest checkpoint straight from memory. The
+// player respawns at full health. Returns 0 if there is no checkpoint yet.
+int checkpoint_restore() {
+    if (ring_count == 0) return 0;
+
+    const Checkpoint* c = &ring[(ring_head + CHECKPOINT_RING - 1) % CHECKPOINT_RING];
+    game.health = MAX_HEALTH;
+    game.score = c->score;
+    memcpy(game.collected_coins, c->collected_coins, sizeof(game.collected_coins));
+
+    load_level(c->level);   // Resident in the level cache, so a pointer swap
+    place_player(&player, c->player_body.x, c->player_body.y);
+    player.prev_position = player.position;
+    player.facing_right = c->facing_right;
+    player.velocityY = 0;
+    player.jumping = 0;
+    // load_level respawned the level; put movers back where they were
+    for (int i = 0; i < entities.count; i++) {
+        for (int j = 0; j < c->moving_count; j++) {
+            if (c->moving[j].spawn_id != entities.spawn_id[i]) continue;
+            entities.x[i] = entities.prev_x[i] = c->moving[j].x;
+            entities.velocityX[i] = c->moving[j].velocityX;
+            break;
+        }
+    }
+
+    ticks_since_capture = 0;
+    captured_level = current_level;
+    if (!game.headless) printf("Restored checkpoint\n");
+    return 1;
+}
@@ -0,0 +1,32 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <SDL/SDL.h>
+#include "game.h"
+#include "objects.h"
+
+#define CHECKPOINT_RING      8                // Recent checkpoints kept in memory
+#define CHECKPOINT_INTERVAL  (TICK_RATE * 5)  // Ticks between autosaves
+#define CHECKPOINT_PATH      "checkpoint.bin"
+
+typedef struct {
+    FixRect  player_body;
+    int      facing_right;
+    int      health;
+    int      score;
+    int      level;
+    int      collected_coins[MAX_LEVELS];
+    int      moving_count;                 // Entries used in `moving`
+    struct {
+        int    spawn_id;
+        fixed_t x;
+        fixed_t velocityX;
+    } moving[MAX_ENTITIES];                // Patrolling entities, by spawn slot
+} Checkpoint;
+
+void init_checkpoints();
+void checkpoint_capture();
+void checkpoint_tick();
+int  checkpoint_restore();
+
+#endif
@@ -0,0 +1,83 @@
+#include "clock.h"
+#include "game.h"
+
+// Wall time owed to the simulation, in units of 1/(1000*TICK_RATE*100) s
+// so that a percent time scale stays exact
+#define STEP_COST (1000 * 100)
+
+static Uint32 ticks       = 0;
+static Uint32 now_ms      = 0;
+static Uint32 last_wall   = 0;
+static int    have_wall   = 0;
+static Uint32 accumulator = 0;
+static int    scale       = CLOCK_SCALE_NORMAL;
+static int    paused      = 0;
+static int    lockstep    = 0;
+
+void clock_reset() {
+    ticks = now_ms = 0;
+    accumulator = 0;
+    have_wall = 0;
+}
+
+// Called once per rendered frame with the wall clock; banks the elapsed
+// time, scaled, for clock_step_due() to pay out in ticks
+void clock_frame(Uint32 wall_ms) {
+    Uint32 frame_ms = have_wall ? wall_ms - last_wall : 0;
+    last_wall = wall_ms;
+    have_wall = 1;
+    if (frame_ms > MAX_FRAME_MS) frame_ms = MAX_FRAME_MS;
+
+    if (paused) return;
+    if (lockstep) accumulator += STEP_COST;   // One tick per frame, whatever the wall clock says
+    else accumulator += frame_ms * TICK_RATE * scale;
+}
+
+// True, and takes one tick's worth of banked time, while a tick is owed
+int clock_step_due() {
+    if (accumulator < STEP_COST) return 0;
+    accumulator -= STEP_COST;
+    return 1;
+}
+
+// Moves game time on by one tick and returns the new time in ms
+Uint32 clock_tick() {
+    ticks++;
+    now_ms = (Uint32)((Uint64)ticks * 1000 / TICK_RATE);
+    return now_ms;
+}
+
+Uint32 clock_now() {
+    return now_ms;
+}
+
+Uint32 clock_ticks() {
+    return ticks;
+}
+
+// How far the next tick is along, for interpolating the last two states
+float clock_alpha() {
+    return accumulator / (float)STEP_COST;
+}
+
+void clock_set_scale(int percent) {
+    if (percent < 1) percent = 1;
+    if (percent > CLOCK_SCALE_MAX) percent = CLOCK_SCALE_MAX;
+    scale = percent;
+}
+
+int clock_scale() {
+    return scale;
+}
+
+void clock_set_paused(int p) {
+    paused = p;
+}
+
+int clock_paused() {
+    return paused;
+}
+
+void clock_set_lockstep(int l) {
+    lockstep = l;
+}
@@ -0,0 +1,29 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <SDL/SDL.h>
+
+#define CLOCK_SCALE_NORMAL  100   // Percent of real time
+#define CLOCK_SCALE_FAST    400   // Fast-forward
+#define CLOCK_SCALE_MAX     1000
+
+// Game time. It advances only when a simulation tick runs, by exactly
+// 1/TICK_RATE s, so every subsystem sees the same "now" for the whole
+// tick and a replay sees the same times as the recording. Wall time only
+// decides how many ticks a rendered frame gets, which is where pause,
+// time scaling and lockstep come in.
+void   clock_reset();
+void   clock_frame(Uint32 wall_ms);
+int    clock_step_due();
+Uint32 clock_tick();
+Uint32 clock_now();
+Uint32 clock_ticks();
+float  clock_alpha();
+
+void   clock_set_scale(int percent);
+int    clock_scale();
+void   clock_set_paused(int paused);
+int    clock_paused();
+void   clock_set_lockstep(int lockstep);
+
+#endif
@@ -0,0 +1,193 @@
+#include "collision.h"
+
+#define NEVER ((Sint64)1 << 62)
+
+// Boxes overlap only if they share interior; touching edges don't count,
+// so a box resting on a solid can still slide along it.
+static int overlaps(FixRect a, FixRect b) {
+    return a.x < b.x + b.w && a.x + a.w > b.x && a.y < b.y + b.h && a.y + a.h > b.y;
+}
+
+// Fraction of `move` needed to cover `dist`, in 16.16 but 64-bit wide so
+// a tiny move against a far solid can't overflow
+static Sint64 fraction(fixed_t dist, fixed_t move) {
+    return ((Sint64)dist << FIX_SHIFT) / move;
+}
+
+// Fixed-point `d * t`, rounded toward zero so a partial move never goes
+// further than the exact one would
+static fixed_t scale_move(fixed_t d, fixed_t t) {
+    return (fixed_t)(((Sint64)d * t) / FIX_ONE);
+}
+
+// Time of impact of `box` moving by (dx, dy) against a static `solid`.
+// Returns 1 and fills time/normal if it hits during the move, 0 if it
+// misses or only grazes a corner. Boxes that already overlap are left to
+// the caller.
+int sweep_aabb(FixRect box, fixed_t dx, fixed_t dy, FixRect solid, fixed_t* time, int* normal_x, int* normal_y) {
+    Sint64 tx_entry, tx_exit, ty_entry, ty_exit;
+
+    if (dx > 0) {
+        tx_entry = fraction(solid.x - (box.x + box.w), dx);
+        tx_exit  = fraction(solid.x + solid.w - box.x, dx);
+    } else if (dx < 0) {
+        tx_entry = fraction(solid.x + solid.w - box.x, dx);
+        tx_exit  = fraction(solid.x - (box.x + box.w), dx);
+    } else {
+        if (box.x + box.w <= solid.x || box.x >= solid.x + solid.w) return 0;
+        tx_entry = -NEVER;
+        tx_exit  = NEVER;
+    }
+
+    if (dy > 0) {
+        ty_entry = fraction(solid.y - (box.y + box.h), dy);
+        ty_exit  = fraction(solid.y + solid.h - box.y, dy);
+    } else if (dy < 0) {
+        ty_entry = fraction(solid.y + solid.h - box.y, dy);
+        ty_exit  = fraction(solid.y - (box.y + box.h), dy);
+    } else {
+        if (box.y + box.h <= solid.y || box.y >= solid.y + solid.h) return 0;
+        ty_entry = -NEVER;
+        ty_exit  = NEVER;
+    }
+
+    Sint64 entry = tx_entry > ty_entry ? tx_entry : ty_entry;
+    Sint64 exit  = tx_exit < ty_exit ? tx_exit : ty_exit;
+    if (entry >= exit || entry < 0 || entry >= FIX_ONE) return 0;
+
+    // On an exact corner hit prefer the vertical normal, so landing wins
+    if (tx_entry > ty_entry) {
+        *normal_x = dx > 0 ? -1 : 1;
+        *normal_y = 0;
+    } else {
+        *normal_x = 0;
+        *normal_y = dy > 0 ? -1 : 1;
+    }
+    *time = (fixed_t)entry;
+    return 1;
+}
+
+static void add_contact(Contact* contacts, int max_contacts, int* count,
+                        int solid, fixed_t time, int normal_x, int normal_y) {
+    if (!contacts || *count >= max_contacts) return;
+    contacts[*count].solid = solid;
+    contacts[*count].time = time;
+    contacts[*count].normal_x = normal_x;
+    contacts[*count].normal_y = normal_y;
+    (*count)++;
+}
+
+// Pushes box out of a solid it already overlaps along the shallower axis
+static void depenetrate(FixRect* box, FixRect s, int* normal_x, int* normal_y) {
+    fixed_t overlapLeft = (box->x + box->w) - s.x;
+    fixed_t overlapRight = (s.x + s.w) - box->x;
+    fixed_t overlapTop = (box->y + box->h) - s.y;
+    fixed_t overlapBottom = (s.y + s.h) - box->y;
+
+    fixed_t xOverlap = (overlapLeft < overlapRight) ? overlapLeft : overlapRight;
+    fixed_t yOverlap = (overlapTop < overlapBottom) ? overlapTop : overlapBottom;
+
+    *normal_x = *normal_y = 0;
+    if (xOverlap < yOverlap) {
+        *normal_x = (overlapLeft < overlapRight) ? -1 : 1;
+        box->x = (*normal_x < 0) ? s.x - box->w : s.x + s.w;
+    } else {
+        *normal_y = (overlapTop < overlapBottom) ? -1 : 1;
+        box->y = (*normal_y < 0) ? s.y - box->h : s.y + s.h;
+    }
+}
+
+// Earliest solid the box hits moving by (dx, dy), or -1. Looks at the
+// solids listed in `index`, or all n of them if index is NULL.
+static int earliest_hit(FixRect box, fixed_t dx, fixed_t dy, const FixRect* solids, const int* index, int n,
+                        fixed_t* time, int* normal_x, int* normal_y) {
+    // Bounds of the whole move, to skip solids it can't reach
+    fixed_t min_x = box.x + (dx < 0 ? dx : 0);
+    fixed_t max_x = box.x + box.w + (dx > 0 ? dx : 0);
+    fixed_t min_y = box.y + (dy < 0 ? dy : 0);
+    fixed_t max_y = box.y + box.h + (dy > 0 ? dy : 0);
+
+    int best = -1, nx, ny;
+    fixed_t t;
+    *time = FIX_ONE;
+    for (int k = 0; k < n; k++) {
+        int i = index ? index[k] : k;
+        FixRect s = solids[i];
+        if (s.x >= max_x || s.x + s.w <= min_x || s.y >= max_y || s.y + s.h <= min_y)
+            continue;
+        if (sweep_aabb(box, dx, dy, s, &t, &nx, &ny) && t < *time) {
+            best = i;
+            *time = t;
+            *normal_x = nx;
+            *normal_y = ny;
+        }
+    }
+    return best;
+}
+
+// Moves box by (dx, dy) through n static solids. Each sweep stops at the
+// earliest hit, cancels motion along its normal and slides the remainder
+// along the other axis, so nothing is skipped however fast the box moves.
+// Every hit is reported in `contacts` (may be NULL); returns how many.
+int resolve_motion(FixRect* box, fixed_t dx, fixed_t dy, const FixRect* solids, int n,
+                   Contact* contacts, int max_contacts) {
+    int count = 0;
+    int nx, ny;
+
+    // The slides never leave the bounds of the full move, so one pass
+    // narrows the solids down for every later sweep. It also catches
+    // solids that moved into the box since last step.
+    int candidates[COLLISION_MAX_CANDIDATES];
+    int m = 0, rescan = 0;
+    fixed_t min_x = box->x + (dx < 0 ? dx : 0);
+    fixed_t max_x = box->x + box->w + (dx > 0 ? dx : 0);
+    fixed_t min_y = box->y + (dy < 0 ? dy : 0);
+    fixed_t max_y = box->y + box->h + (dy > 0 ? dy : 0);
+    for (int i = 0; i < n; i++) {
+        FixRect s = solids[i];
+        if (s.x >= max_x || s.x + s.w <= min_x || s.y >= max_y || s.y + s.h <= min_y)
+            continue;
+        if (overlaps(*box, s)) {
+            depenetrate(box, s, &nx, &ny);
+            add_contact(contacts, max_contacts, &count, i, 0, nx, ny);
+            rescan = 1;     // Pushed out of the bounds computed above
+        }
+        if (m < COLLISION_MAX_CANDIDATES) candidates[m++] = i;
+        else rescan = 1;
+    }
+    if (!m && !rescan) {
+        box->x += dx;
+        box->y += dy;
+        return count;
+    }
+
+    for (int step = 0; step < COLLISION_MAX_STEPS && (dx || dy); step++) {
+        fixed_t t;
+        int best = rescan ? earliest_hit(*box, dx, dy, solids, NULL, n, &t, &nx, &ny)
+                          : earliest_hit(*box, dx, dy, solids, candidates, m, &t, &nx, &ny);
+        if (best < 0) {
+            box->x += dx;
+            box->y += dy;
+            break;
+        }
+
+        // Snap flush against the solid; truncating the other axis keeps
+        // the box short of anything it would have hit later
+        FixRect s = solids[best];
+        if (nx) {
+            fixed_t moved = scale_move(dy, t);
+            box->x = (nx < 0) ? s.x - box->w : s.x + s.w;
+            box->y += moved;
+            dy -= moved;
+            dx = 0;
+        } else {
+            fixed_t moved = scale_move(dx, t);
+            box->y = (ny < 0) ? s.y - box->h : s.y + s.h;
+            box->x += moved;
+            dx -= moved;
+            dy = 0;
+        }
+        add_contact(contacts, max_contacts, &count, best, t, nx, ny);
+    }
+    return count;
+}
@@ -0,0 +1,25 @@
+#ifndef COLLISION_H
+#define COLLISION_H
+
+#include <SDL/SDL.h>
+#include "fixed.h"
+
+#define MAX_CONTACTS        8
+#define COLLISION_MAX_STEPS 4   // Sweeps per move; each hit removes one axis
+#define COLLISION_MAX_CANDIDATES 64
+
+// One solid the moving box ran into. normal_x/normal_y point away from the
+// solid (-1, 0 or 1, one of them zero); time is the fraction of the move
+// done when it hit (0..FIX_ONE), 0 for a box that already overlapped.
+typedef struct {
+    int   solid;                // Index into the solids array
+    fixed_t time;
+    int   normal_x;
+    int   normal_y;
+} Contact;
+
+int sweep_aabb(FixRect box, fixed_t dx, fixed_t dy, FixRect solid, fixed_t* time, int* normal_x, int* normal_y);
+int resolve_motion(FixRect* box, fixed_t dx, fixed_t dy, const FixRect* solids, int n,
+                   Contact* contacts, int max_contacts);
+
+#endif
@@ -0,0 +1,83 @@
+#include "dirty.h"
+#include <string.h>
+
+// Rects drawn last frame (restored from the background this frame) and rects
+// drawn this frame. Both sets are pushed to the display on present.
+static SDL_Rect prev_rects[MAX_DIRTY_RECTS];
+static SDL_Rect cur_rects[MAX_DIRTY_RECTS];
+static int prev_count = 0;
+static int cur_count  = 0;
+
+static int enabled     = 1;
+static int full_redraw = 1;  // Restore and present the whole screen
+static int overflowed  = 0;  // cur_rects ran out of room this frame
+
+void dirty_init(int on) {
+    enabled = on;
+    prev_count = 0;
+    cur_count = 0;
+    full_redraw = 1;
+    overflowed = 0;
+}
+
+int dirty_enabled() {
+    return enabled;
+}
+
+void dirty_invalidate() {
+    full_redraw = 1;
+}
+
+// Redraws whatever changed since last frame with `fill`, which draws the
+// background into one screen rect
+void dirty_restore(SDL_Surface* screen, DirtyFill fill) {
+    if (full_redraw) {
+        SDL_Rect all = {0, 0, (Uint16)screen->w, (Uint16)screen->h};
+        fill(screen, all);
+        return;
+    }
+    for (int i = 0; i < prev_count; i++)
+        fill(screen, prev_rects[i]);
+}
+
+void dirty_mark(SDL_Rect r) {
+    if (!enabled) return;
+
+    SDL_Surface* screen = SDL_GetVideoSurface();
+    int x0 = r.x, y0 = r.y;
+    int x1 = r.x + r.w, y1 = r.y + r.h;
+    if (x0 < 0) x0 = 0;
+    if (y0 < 0) y0 = 0;
+    if (x1 > screen->w) x1 = screen->w;
+    if (y1 > screen->h) y1 = screen->h;
+    if (x1 <= x0 || y1 <= y0) return;
+
+    if (cur_count == MAX_DIRTY_RECTS) {
+        overflowed = 1;
+        return;
+    }
+    SDL_Rect* c = &cur_rects[cur_count++];
+    c->x = (Sint16)x0;
+    c->y = (Sint16)y0;
+    c->w = (Uint16)(x1 - x0);
+    c->h = (Uint16)(y1 - y0);
+}
+
+void dirty_present(SDL_Surface* screen) {
+    if (!enabled || full_redraw || overflowed) {
+        SDL_Flip(screen);
+    } else {
+        SDL_Rect update[MAX_DIRTY_RECTS * 2];
+        memcpy(update, prev_rects, prev_count * sizeof(SDL_Rect));
+        memcpy(update + prev_count, cur_rects, cur_count * sizeof(SDL_Rect));
+        SDL_UpdateRects(screen, prev_count + cur_count, update);
+    }
+
+    // A rect we dropped can't be restored next frame, so fall back to a
+    // full redraw once more.
+    full_redraw = overflowed;
+    overflowed = 0;
+    memcpy(prev_rects, cur_rects, cur_count * sizeof(SDL_Rect));
+    prev_count = cur_count;
+    cur_count = 0;
+}
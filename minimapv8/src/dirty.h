@@ -0,0 +1,17 @@
+#ifndef DIRTY_H
+#define DIRTY_H
+
+#include <SDL/SDL.h>
+
+#define MAX_DIRTY_RECTS 64
+
+typedef void (*DirtyFill)(SDL_Surface* screen, SDL_Rect r);
+
+void dirty_init(int enabled);
+int  dirty_enabled();
+void dirty_invalidate();
+void dirty_restore(SDL_Surface* screen, DirtyFill fill);
+void dirty_mark(SDL_Rect r);
+void dirty_present(SDL_Surface* screen);
+
+#endif
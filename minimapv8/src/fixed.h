@@ -0,0 +1,36 @@
+#ifndef FIXED_H
+#define FIXED_H
+
+#include <SDL/SDL.h>
+
+// 16.16 fixed point for simulation state. Integer-only, so a run gives the
+// same result on every machine and compiler; SDL_Rects are derived from it
+// for drawing and never fed back.
+typedef Sint32 fixed_t;
+
+#define FIX_SHIFT       16
+#define FIX_ONE         (1 << FIX_SHIFT)
+#define INT_TO_FIX(i)   ((fixed_t)(i) * FIX_ONE)
+#define FIX_TO_INT(f)   ((int)((f) >> FIX_SHIFT))   // Rounds toward -infinity
+#define FIX_FRAC(n, d)  ((fixed_t)(((Sint64)(n) << FIX_SHIFT) / (d)))
+
+typedef struct {
+    fixed_t x, y, w, h;
+} FixRect;
+
+static inline fixed_t fix_mul(fixed_t a, fixed_t b) {
+    return (fixed_t)(((Sint64)a * b) >> FIX_SHIFT);
+}
+
+static inline FixRect fix_rect(SDL_Rect r) {
+    FixRect f = {INT_TO_FIX(r.x), INT_TO_FIX(r.y), INT_TO_FIX(r.w), INT_TO_FIX(r.h)};
+    return f;
+}
+
+static inline SDL_Rect fix_to_rect(FixRect f) {
+    SDL_Rect r = {(Sint16)FIX_TO_INT(f.x), (Sint16)FIX_TO_INT(f.y),
+                  (Uint16)FIX_TO_INT(f.w), (Uint16)FIX_TO_INT(f.h)};
+    return r;
+}
+
+#endif
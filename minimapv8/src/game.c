@@ -1,29 +1,141 @@
 #include "game.h"
 #include "objects.h"
 #include "minimap.h"
+#include "dirty.h"
+#include "text.h"
+#include "loader.h"
+#include "pack.h"
+#include "save.h"
+#include "sprite.h"
+#include "checkpoint.h"
+#include "input.h"
+#include "clock.h"
+#include "profile.h"
+#include "present.h"
+#include "camera.h"
+#include "tilemap.h"
 #include <SDL/SDL.h>
 #include <SDL/SDL_image.h>
 #include <SDL/SDL_ttf.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 
 GameState    game;
 int          flashBackground = 0;
 Uint32       flashStartTime  = 0;
 TTF_Font*    font            = NULL;
-SDL_Surface *sky = NULL, *city = NULL, *ground = NULL;
+SDL_Surface *background = NULL;   // sky, city and ground composed once per level
+static int   background_level = -1;
+static int   use_tilemap = 0;     // Backgrounds come from packed tiles, not `background`
 Player       player;
 int          current_level = 0;
 
-void render_text(SDL_Surface* screen, TTF_Font* font, const char* text, int x, int y) {
-    SDL_Color white = {255,255,255,255};
-    SDL_Surface* ts = TTF_RenderText_Blended(font, text, white);
-    if (ts) {
-        SDL_Rect dst = {x,y,ts->w,ts->h};
-        SDL_BlitSurface(ts, NULL, screen, &dst);
-        SDL_FreeSurface(ts);
+SDL_Rect lerp_rect(SDL_Rect from, SDL_Rect to, float alpha) {
+    SDL_Rect r = to;
+    r.x = (Sint16)(from.x + (to.x - from.x) * alpha + 0.5f);
+    r.y = (Sint16)(from.y + (to.y - from.y) * alpha + 0.5f);
+    return r;
+}
+
+static int blit_layer(const char* path, SDL_Surface* dst, int y) {
+    SDL_Surface* tmp = IMG_Load(path);
+    if(!tmp) {
+        fprintf(stderr,"Failed to load %s: %s\n", path, IMG_GetError());
+        return 0;
+    }
+    // The layers used to go through SDL_DisplayFormat, which drops per-pixel
+    // alpha, so copy them opaque to keep the same picture.
+    SDL_SetAlpha(tmp, 0, 0);
+    SDL_Rect pos = {0, y, tmp->w, tmp->h};
+    SDL_BlitSurface(tmp, NULL, dst, &pos);
+    SDL_FreeSurface(tmp);
+    return 1;
+}
+
+// Loose files a level is composed from, bottom first, and where they go
+static const char* const level_layers[3] = {"assets/sky%d.jpg", "assets/city%d.png", "assets/ground%d.png"};
+static const int         level_layer_y[3] = {0, 0, GROUND_LEVEL};
+
+// Flattens sky, city and ground of a level into one opaque display-format
+// surface, one screen wide; it repeats across the level as it scrolls.
+// Only used without an asset archive, which holds levels as tiles.
+// Returns NULL (after reporting why) if a layer can't be loaded.
+SDL_Surface* compose_level(int level) {
+    SDL_PixelFormat* fmt = game.screen->format;
+    SDL_Surface* composed = SDL_CreateRGBSurface(SDL_SWSURFACE, SCREEN_WIDTH, SCREEN_HEIGHT,
+                                                 fmt->BitsPerPixel, fmt->Rmask, fmt->Gmask,
+                                                 fmt->Bmask, 0);
+    if(!composed) {
+        fprintf(stderr,"Failed to create level background: %s\n", SDL_GetError());
+        return NULL;
+    }
+
+    for(int i = 0; i < 3; i++) {
+        char path[64];
+        snprintf(path, sizeof(path), level_layers[i], level + 1);
+        if(!blit_layer(path, composed, level_layer_y[i])) {
+            SDL_FreeSurface(composed);
+            return NULL;
+        }
+    }
+    return composed;
+}
+
+// The whole width of a level in one surface, for one-off work such as
+// building its minimap. NULL if it can't be loaded.
+SDL_Surface* compose_world(int level) {
+    if(use_tilemap) return tilemap_compose(level);
+
+    // The level on screen is already composed; only decode other levels
+    int reuse = background && background_level == level;
+    SDL_Surface* screen = reuse ? background : compose_level(level);
+    if(!screen) return NULL;
+    SDL_PixelFormat* fmt = screen->format;
+    SDL_Surface* world = SDL_CreateRGBSurface(SDL_SWSURFACE, WORLD_WIDTH, SCREEN_HEIGHT,
+                                              fmt->BitsPerPixel, fmt->Rmask, fmt->Gmask,
+                                              fmt->Bmask, 0);
+    for(int x = 0; world && x < WORLD_WIDTH; x += SCREEN_WIDTH) {
+        SDL_Rect pos = {(Sint16)x, 0, 0, 0};
+        SDL_BlitSurface(screen, NULL, world, &pos);
+    }
+    if(!reuse) SDL_FreeSurface(screen);
+    return world;
+}
+
+static Uint32 fnv1a_step(Uint32 h, const void* data, size_t n) {
+    const Uint8* p = data;
+    for(size_t k = 0; k < n; k++) {
+        h ^= p[k];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Changes whenever a level's look may have changed, without composing it:
+// the content hash the packer stored, or for loose files an FNV-1a over
+// the layer files' names, sizes and modification times, so nothing is
+// read. Not a content hash in that case. 0 if unknown.
+Uint32 level_cache_key(int level) {
+    if(use_tilemap) {
+        char name[PACK_NAME_LEN];
+        snprintf(name, sizeof(name), PACK_MAP_NAME, level + 1);
+        return pack_hash(name);
+    }
+
+    Uint32 h = 2166136261u;
+    for(int i = 0; i < 3; i++) {
+        char path[64];
+        snprintf(path, sizeof(path), level_layers[i], level + 1);
+        struct stat st;
+        if(stat(path, &st) != 0) return 0;
+        Sint64 size = (Sint64)st.st_size, mtime = (Sint64)st.st_mtime;
+        h = fnv1a_step(h, path, strlen(path));
+        h = fnv1a_step(h, &size, sizeof(size));
+        h = fnv1a_step(h, &mtime, sizeof(mtime));
     }
+    return h ? h : 1;
 }
 
 void load_level(int level) {
@@ -34,58 +146,71 @@ void load_level(int level) {
 
     // Handle special transitions
     if (previous_level == 2 && current_level == 3) { // City3 -> City4
-        player.position.x = 380;  // Start at left edge
-        player.position.y = 465;
+        place_player(&player, INT_TO_FIX(380), INT_TO_FIX(465));  // Start at left edge
     }
     else if (previous_level == 3 && current_level == 2) { // City4 -> City3
-        player.position.x = 545;
-        player.position.y = 450;
+        place_player(&player, INT_TO_FIX(545), INT_TO_FIX(450));
     }
 
-    if(sky) SDL_FreeSurface(sky);
-    if(city) SDL_FreeSurface(city);
-    if(ground) SDL_FreeSurface(ground);
-
-    char sky_path[64], city_path[64], ground_path[64];
-    snprintf(sky_path, sizeof(sky_path), "assets/sky%d.jpg", level + 1);
-    snprintf(city_path, sizeof(city_path), "assets/city%d.png", level + 1);
-    snprintf(ground_path, sizeof(ground_path), "assets/ground%d.png", level + 1);
-
-    SDL_Surface* tmp = IMG_Load(sky_path);
-    if(!tmp) { 
-        fprintf(stderr,"Failed to load %s: %s\n", sky_path, IMG_GetError());
-        cleanup_game();
-        exit(1);
-    }
-    sky = SDL_DisplayFormat(tmp);
-    SDL_FreeSurface(tmp);
-
-    tmp = IMG_Load(city_path);
-    if(!tmp) { 
-        fprintf(stderr,"Failed to load %s: %s\n", city_path, IMG_GetError());
-        cleanup_game();
-        exit(1);
+    if(use_tilemap) {
+        if(!tilemap_load(level)) {
+            cleanup_game();
+            exit(1);
+        }
     }
-    city = SDL_DisplayFormat(tmp);
-    SDL_FreeSurface(tmp);
-
-    tmp = IMG_Load(ground_path);
-    if(!tmp) { 
-        fprintf(stderr,"Failed to load %s: %s\n", ground_path, IMG_GetError());
-        cleanup_game();
-        exit(1);
+    // Reloading the level on screen (e.g. load_game) keeps its background
+    else if(!game.headless && (level != background_level || !background)) {
+        SDL_Surface* composed = loader_acquire(level);
+        if(!composed) {
+            cleanup_game();
+            exit(1);
+        }
+        if(background) loader_release(background_level, background);
+        background = composed;
+        background_level = level;
     }
-    ground = SDL_DisplayFormat(tmp);
-    SDL_FreeSurface(tmp);
+    if(!game.headless && !use_tilemap) loader_prefetch_neighbors(level);
+    dirty_invalidate();
 
     init_objects();
+    minimap_load_level(level);
+    player.prev_position = player.position;  // Don't interpolate across the jump
+}
+
+static void init_level_state() {
+    load_level(0);
+    game.running = 1;
+    game.health  = MAX_HEALTH;
+    game.score   = 0;
+    game.previous_level = 0;
+    memset(game.collected_coins, 0, sizeof(game.collected_coins));
+}
+
+// Converts an old save.txt once, before anything can write save.bin and
+// shadow it
+static void migrate_legacy_save() {
+    FILE* f = fopen(SAVE_PATH, "rb");
+    if (f) {
+        fclose(f);
+        return;
+    }
+    SaveData d;
+    if (!save_read_legacy(LEGACY_SAVE_PATH, &d)) return;
+    printf("Migrating %s to %s\n", LEGACY_SAVE_PATH, SAVE_PATH);
+    save_write_async(SAVE_PATH, &d);
 }
 
 void init_game() {
-    if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+    if (SDL_Init(game.headless ? SDL_INIT_TIMER : SDL_INIT_VIDEO) < 0) {
         fprintf(stderr,"SDL_Init: %s\n", SDL_GetError());
         exit(1);
     }
+    if (game.headless) {
+        init_pack(PACK_PATH);
+        init_save();
+        init_level_state();
+        return;
+    }
     if (!(IMG_Init(IMG_INIT_PNG)&IMG_INIT_PNG)) {
         fprintf(stderr,"IMG_Init: %s\n", IMG_GetError());
         SDL_Quit();
@@ -104,33 +229,95 @@ void init_game() {
         cleanup_game();
         exit(1);
     }
+    init_text(font);
 
-    game.screen = SDL_SetVideoMode(SCREEN_WIDTH, SCREEN_HEIGHT, 32, SDL_SWSURFACE);
+    game.screen = SDL_SetVideoMode(SCREEN_WIDTH, SCREEN_HEIGHT, 32, present_video_flags());
     if (!game.screen) {
         fprintf(stderr,"SDL_SetVideoMode: %s\n", SDL_GetError());
         cleanup_game();
         exit(1);
     }
+    init_present(game.screen);
 
-    load_level(0);
-    game.running = 1;
-    game.health  = MAX_HEALTH;
-    game.score   = 0;
-    game.previous_level = 0;
-    memset(game.collected_coins, 0, sizeof(game.collected_coins));
-    save_game();
+    init_pack(PACK_PATH);
+    init_save();
+    use_tilemap = init_tilemap();
+    if (!use_tilemap) init_loader();   // Only loose-file levels are composed
+    init_level_state();
+    if (!input_replaying() && !input_recording()) migrate_legacy_save();
+}
+
+// Advances the simulation by one fixed tick
+void step_game(InputState input) {
+    Uint32 now = clock_tick();
+    player.prev_position = player.position;
+    snapshot_objects();
+
+    profile_begin(PROF_INPUT);
+    if (input & INPUT_SAVE) save_game();
+    if (input & INPUT_LOAD) load_game();
+    if (input & INPUT_ENTER) {
+        int trigger = find_trigger(player.position);
+        if (trigger >= 0)
+            load_level(entities.target[trigger]);
+    }
+
+    handle_input_player(&player, input);
+    profile_end(PROF_INPUT);
+
+    profile_begin(PROF_PLAYER);
+    update_player(&player, now);
+    profile_end(PROF_PLAYER);
+
+    profile_begin(PROF_OBJECTS);
+    update_objects(now);
+    checkpoint_tick();
+    profile_end(PROF_OBJECTS);
 }
 
-void update_game() {
-    SDL_BlitSurface(sky,  NULL, game.screen, NULL);
-    SDL_BlitSurface(city, NULL, game.screen, NULL);
-    SDL_Rect gpos = {0, GROUND_LEVEL, ground->w, ground->h};
-    SDL_BlitSurface(ground, NULL, game.screen, &gpos);
+// Draws the level under screen rect r as seen from the camera. A composed
+// background is one screen wide and repeats, so r may straddle a seam.
+static void draw_background(SDL_Surface* screen, SDL_Rect r) {
+    if (use_tilemap) {
+        tilemap_draw(screen, r, camera.x);
+        return;
+    }
+    int x = r.x, end = r.x + r.w;
+    while (x < end) {
+        int src_x = (x + camera.x) % background->w;
+        int w = background->w - src_x;
+        if (w > end - x) w = end - x;
+        SDL_Rect src = {(Sint16)src_x, r.y, (Uint16)w, r.h};
+        SDL_Rect dst = {(Sint16)x, r.y, (Uint16)w, r.h};
+        SDL_BlitSurface(background, &src, screen, &dst);
+        x += w;
+    }
+}
 
-    draw_objects();
-    draw_player(&player, game.screen);
+void update_game(float alpha) {
+    camera_follow(lerp_rect(player.prev_position, player.position, alpha));
+
+    profile_begin(PROF_BACKGROUND);
+    if (use_tilemap) tilemap_stream(camera.x);
+    if (dirty_enabled()) {
+        dirty_restore(game.screen, draw_background);
+    } else {
+        SDL_Rect all = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
+        draw_background(game.screen, all);
+    }
+    profile_end(PROF_BACKGROUND);
+
+    profile_begin(PROF_DRAW_OBJECTS);
+    draw_objects(alpha, clock_now());
+    profile_end(PROF_DRAW_OBJECTS);
+    profile_begin(PROF_DRAW_PLAYER);
+    draw_player(&player, game.screen, alpha);
+    profile_end(PROF_DRAW_PLAYER);
+    profile_begin(PROF_MINIMAP);
     draw_minimap();
+    profile_end(PROF_MINIMAP);
 
+    profile_begin(PROF_TEXT);
     render_text(game.screen, font, "Press S to Save | Press L to Load", 10, SCREEN_HEIGHT - 30);
 
     SDL_Rect hb_bg = {10,10,200,20};
@@ -138,80 +325,90 @@ void update_game() {
     int hw = (int)((game.health/(float)MAX_HEALTH) * hb_bg.w);
     SDL_Rect hb_fg = {10,10,hw,20};
     SDL_FillRect(game.screen, &hb_fg, SDL_MapRGB(game.screen->format,200,0,0));
+    dirty_mark(hb_bg);
 
     char buf[32];
     snprintf(buf, sizeof(buf), "Score: %d", game.score);
-    render_text(game.screen, font, buf, 10, 40);
+    render_text_dynamic(game.screen, buf, 10, 40);
 
-    if (current_level == 2) {
-        SDL_Rect subwayArea = {545, 450, 50, 50};
-        if (check_collision(player.position, subwayArea)) {
-            render_text(game.screen, font, "PRESS E TO ENTER SUBWAY", 545, 430);
-        }
-    }
-     else if (current_level == 3) { // City4 subway exit
-        SDL_Rect exitSubwayArea = {380, 465, 50, 50};
-        if (check_collision(player.position, exitSubwayArea)) {
-            render_text(game.screen, font, "PRESS E TO LEAVE SUBWAY", 380, 445);
-        }
+    int trigger = find_trigger(player.position);
+    if (trigger >= 0 && entities.prompt[trigger]) {
+        SDL_Rect area = camera_to_screen(entity_rect(trigger));
+        render_text(game.screen, font, entities.prompt[trigger], area.x, area.y - 20);
     }
 
-    SDL_Flip(game.screen);
+    if (clock_paused())
+        render_text(game.screen, font, "PAUSED - Press P to resume", SCREEN_WIDTH / 2 - 90, SCREEN_HEIGHT / 2);
+    profile_end(PROF_TEXT);
+
+    draw_profile(game.screen);
+
+    profile_begin(PROF_PRESENT);
+    dirty_present(game.screen);
+    profile_end(PROF_PRESENT);
+}
+
+// Recordings, replays and headless runs keep their save slot here, so S
+// and L behave the same when recorded and replayed on any machine, and the
+// player's save.bin is never touched
+static SaveData memory_save;
+static int      memory_save_used = 0;
+
+static int save_in_memory() {
+    return game.headless || input_replaying() || input_recording();
 }
 
 void save_game() {
-    FILE* f = fopen("save.txt","w");
-    if (!f) {
-        fprintf(stderr,"Cannot write save.txt\n");
-        return;
+    SaveData d;
+    d.x = player.position.x;
+    d.y = player.position.y;
+    d.coin_active = !game.collected_coins[current_level];
+    d.health = game.health;
+    d.score = game.score;
+    d.level = current_level;
+    memcpy(d.collected_coins, game.collected_coins, sizeof(d.collected_coins));
+    if (save_in_memory()) {
+        memory_save = d;
+        memory_save_used = 1;
+    } else {
+        save_write_async(SAVE_PATH, &d);
     }
-    fprintf(f,"%d %d %d %d %d %d",
-            (int)player.position.x,
-            (int)player.position.y,
-            coin.active,
-            game.health,
-            game.score,
-            current_level);
-    for (int i = 0; i < MAX_LEVELS; i++) {
-        fprintf(f, " %d", game.collected_coins[i]);
-    }
-    fprintf(f, "\n");
-    fclose(f);
     printf("Game saved successfully!\n");
 }
 
 void load_game() {
-    FILE* f = fopen("save.txt","r");
-    if (!f) {
+    SaveData d;
+    if (save_in_memory()) {
+        if (!memory_save_used) {
+            fprintf(stderr,"No save file\n");
+            return;
+        }
+        d = memory_save;
+    } else if (!save_read(SAVE_PATH, &d)) {
         fprintf(stderr,"No save file\n");
         return;
     }
-    int x, y, saved_level;
-    fscanf(f,"%d %d %d %d %d %d",
-           &x,
-           &y,
-           &coin.active,
-           &game.health,
-           &game.score,
-           &saved_level);
-    for (int i = 0; i < MAX_LEVELS; i++) {
-        if (fscanf(f, " %d", &game.collected_coins[i]) != 1) {
-            game.collected_coins[i] = 0;
-        }
-    }
-    fclose(f);
 
-    player.position.x = (Sint16)x;
-    player.position.y = (Sint16)y;
-    load_level(saved_level);
+    game.health = d.health;
+    game.score = d.score;
+    memcpy(game.collected_coins, d.collected_coins, sizeof(game.collected_coins));
+    place_player(&player, INT_TO_FIX(d.x), INT_TO_FIX(d.y));
+    load_level(d.level);
     printf("Game loaded successfully!\n");
 }
 
 void cleanup_game() {
-    if (sky) SDL_FreeSurface(sky);
-    if (city) SDL_FreeSurface(city);
-    if (ground) SDL_FreeSurface(ground);
+    input_close();
+    cleanup_profile();
+    cleanup_save();
+    if (!game.headless) cleanup_minimap();
+    if (use_tilemap) cleanup_tilemap();
+    else if (!game.headless) cleanup_loader();
+    if (background) SDL_FreeSurface(background);
+    cleanup_sprites();
+    cleanup_text();
     if (font) TTF_CloseFont(font);
+    cleanup_pack();
     TTF_Quit();
     IMG_Quit();
     SDL_Quit();
@@ -8,10 +8,17 @@
 
 #define SCREEN_WIDTH   800
 #define SCREEN_HEIGHT  600
+#define LEVEL_SCREENS  3     // Each level scrolls across this many screens
+#define WORLD_WIDTH    (SCREEN_WIDTH * LEVEL_SCREENS)
 #define GROUND_LEVEL   534
 #define MAX_HEALTH     100
 #define MAX_LEVELS     6
 
+// Fixed-timestep simulation. Movement constants are tuned per tick, so the
+// tick rate matches the ~60 Hz the old SDL_Delay(16) loop ran at.
+#define TICK_RATE      60
+#define MAX_FRAME_MS   250   // Longest frame fed to the accumulator
+
 typedef struct {
     SDL_Surface* screen;
     int          running;
@@ -19,22 +26,27 @@ typedef struct {
     int          score;
     int          collected_coins[MAX_LEVELS];
     int          previous_level;
+    int          headless;      // No window: simulation only, nothing decoded or drawn
 } GameState;
 
 extern GameState   game;
 extern int         flashBackground;
 extern Uint32      flashStartTime;
 extern TTF_Font*   font;
-extern SDL_Surface *sky, *city, *ground;
+extern SDL_Surface *background;
 extern Player      player;
 extern int         current_level;
 
 void init_game();
-void update_game();
+void step_game(InputState input);
+void update_game(float alpha);
 void save_game();
 void load_game();
 void cleanup_game();
-void render_text(SDL_Surface* screen, TTF_Font* font, const char* text, int x, int y);
 void load_level(int level);
+SDL_Surface* compose_level(int level);
+SDL_Surface* compose_world(int level);
+Uint32 level_cache_key(int level);
+SDL_Rect lerp_rect(SDL_Rect from, SDL_Rect to, float alpha);
 
 #endif
@@ -0,0 +1,61 @@
+#include "headless.h"
+#include "game.h"
+#include "player.h"
+#include "objects.h"
+#include "checkpoint.h"
+#include "pack.h"
+#include "input.h"
+#include "clock.h"
+#include <SDL/SDL.h>
+#include <stdio.h>
+
+// Stands in for the keyboard unless a recording is replayed: walk, jump
+// twice a second and turn around now and then, which is enough to cross
+// levels, hit platforms and pick up coins in both directions.
+static InputState scripted_input(long tick) {
+    InputState s = ((tick / HEADLESS_TURN_EVERY) % 2 == 0) ? INPUT_RIGHT : INPUT_LEFT;
+    if (tick % HEADLESS_JUMP_EVERY == 0) s |= INPUT_JUMP;
+    return s;
+}
+
+// Runs the simulation for `ticks` fixed steps, or to the end of the replay,
+// as fast as it goes with no window and no decoded images, and reports the
+// tick rate
+int run_headless(long ticks) {
+    int sheet_w, sheet_h;
+
+    game.headless = 1;
+    init_game();
+    if (!image_size(PLAYER_SHEET, &sheet_w, &sheet_h)) {
+        fprintf(stderr, "Failed to read the size of %s\n", PLAYER_SHEET);
+        cleanup_game();
+        return 1;
+    }
+    init_player_size(&player, sheet_w, sheet_h);
+    init_objects();
+    init_checkpoints();
+
+    clock_reset();   // Game time starts at the first tick, as in a recording
+    int level_changes = 0, last_level = current_level;
+    Uint32 start = SDL_GetTicks();
+    long t;
+    for (t = 0; input_replaying() ? !input_finished() : t < ticks; t++) {
+        step_game(input_tick(scripted_input(t)));
+
+        if (current_level != last_level) {
+            level_changes++;
+            last_level = current_level;
+        }
+    }
+    Uint32 elapsed = SDL_GetTicks() - start;
+
+    printf("headless: %ld ticks (%.1f s of game time) in %u ms, %.0f ticks/s (%.0fx real time)\n",
+           t, clock_now() / 1000.0, (unsigned)elapsed, elapsed ? t * 1000.0 / elapsed : 0.0,
+           elapsed ? clock_now() / (double)elapsed : 0.0);
+    printf("  level %d, score %d, health %d, %d level changes, player at %.4f,%.4f\n",
+           current_level, game.score, game.health, level_changes,
+           player.body.x / (double)FIX_ONE, player.body.y / (double)FIX_ONE);
+
+    cleanup_game();
+    return 0;
+}
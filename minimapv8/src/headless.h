@@ -0,0 +1,10 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#define HEADLESS_TICKS      100000            // Default run length
+#define HEADLESS_JUMP_EVERY (TICK_RATE / 2)
+#define HEADLESS_TURN_EVERY (TICK_RATE * 20)  // Ticks between direction changes
+
+int run_headless(long ticks);
+
+#endif
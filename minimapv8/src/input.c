@@ -0,0 +1,156 @@
+#include "input.h"
+#include "game.h"
+#include <stdio.h>
+#include <string.h>
+
+static FILE*      record_file = NULL;
+static FILE*      replay_file = NULL;
+static Uint32     tick        = 0;   // Ticks handed out so far
+static Uint32     total_ticks = 0;   // Length of the replay
+static InputState current     = 0;
+static Uint32     last_change = 0;   // Recording: tick of the last entry
+static Uint32     next_change = 0;   // Replay: tick the pending entry starts at
+static InputState next_state  = 0;
+static int        have_next   = 0;
+
+static void put32(Uint8* p, Uint32 v) {
+    p[0] = (Uint8)v;
+    p[1] = (Uint8)(v >> 8);
+    p[2] = (Uint8)(v >> 16);
+    p[3] = (Uint8)(v >> 24);
+}
+
+static Uint32 get32(const Uint8* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((Uint32)p[3] << 24);
+}
+
+static void write_header(FILE* f, Uint32 ticks) {
+    Uint8 h[INPUT_HEADER_SIZE];
+    memcpy(h, INPUT_MAGIC, 4);
+    put32(h + 4, INPUT_VERSION);
+    put32(h + 8, TICK_RATE);
+    put32(h + 12, ticks);
+    fwrite(h, 1, sizeof(h), f);
+}
+
+static void write_varint(FILE* f, Uint32 v) {
+    while (v >= 0x80) {
+        fputc((int)(v & 0x7F) | 0x80, f);
+        v >>= 7;
+    }
+    fputc((int)v, f);
+}
+
+static int read_varint(FILE* f, Uint32* v) {
+    *v = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        int c = fgetc(f);
+        if (c == EOF) return 0;
+        *v |= (Uint32)(c & 0x7F) << shift;
+        if (!(c & 0x80)) return 1;
+    }
+    return 0;
+}
+
+// Loads the next change from the replay; have_next is 0 at the end
+static void read_entry() {
+    Uint32 delta;
+    int state;
+    have_next = read_varint(replay_file, &delta) && (state = fgetc(replay_file)) != EOF;
+    if (!have_next) return;
+    next_change += delta;
+    next_state = (InputState)state;
+}
+
+InputState input_from_keys(const Uint8* keystate) {
+    InputState s = 0;
+    if (keystate[SDLK_LEFT])  s |= INPUT_LEFT;
+    if (keystate[SDLK_RIGHT]) s |= INPUT_RIGHT;
+    if (keystate[SDLK_UP])    s |= INPUT_JUMP;
+    return s;
+}
+
+// Starts writing every tick's input to `path`. Returns 0 if it can't.
+int input_record(const char* path) {
+    record_file = fopen(path, "wb");
+    if (!record_file) {
+        fprintf(stderr, "Cannot write %s\n", path);
+        return 0;
+    }
+    write_header(record_file, 0);   // Tick count is filled in on close
+    tick = last_change = 0;
+    current = 0;
+    return 1;
+}
+
+// Replaces live input with the recording in `path`. Returns 0 if the file
+// is missing or wasn't recorded by this version at this tick rate.
+int input_replay(const char* path) {
+    Uint8 h[INPUT_HEADER_SIZE];
+    replay_file = fopen(path, "rb");
+    if (!replay_file) {
+        fprintf(stderr, "Cannot open %s\n", path);
+        return 0;
+    }
+    if (fread(h, 1, sizeof(h), replay_file) != sizeof(h) || memcmp(h, INPUT_MAGIC, 4) != 0 ||
+        get32(h + 4) != INPUT_VERSION || get32(h + 8) != TICK_RATE) {
+        fprintf(stderr, "%s is not a recording this build can replay\n", path);
+        fclose(replay_file);
+        replay_file = NULL;
+        return 0;
+    }
+    total_ticks = get32(h + 12);
+    tick = next_change = 0;
+    current = 0;
+    read_entry();
+    printf("Replaying %s: %u ticks\n", path, (unsigned)total_ticks);
+    return 1;
+}
+
+int input_replaying() {
+    return replay_file != NULL;
+}
+
+int input_recording() {
+    return record_file != NULL;
+}
+
+int input_finished() {
+    return replay_file && tick >= total_ticks;
+}
+
+// Input for the next tick: the recorded state when replaying, otherwise
+// `live`, which is also written out when recording
+InputState input_tick(InputState live) {
+    if (replay_file) {
+        while (have_next && next_change <= tick) {
+            current = next_state;
+            read_entry();
+        }
+        tick++;
+        return current;
+    }
+
+    if (record_file && live != current) {
+        write_varint(record_file, tick - last_change);
+        fputc(live, record_file);
+        last_change = tick;
+    }
+    current = live;
+    tick++;
+    return live;
+}
+
+void input_close() {
+    if (record_file) {
+        fseek(record_file, 0, SEEK_SET);
+        write_header(record_file, tick);
+        fclose(record_file);
+        record_file = NULL;
+        printf("Recorded %u ticks\n", (unsigned)tick);
+    }
+    if (replay_file) {
+        fclose(replay_file);
+        replay_file = NULL;
+    }
+}
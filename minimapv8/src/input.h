@@ -0,0 +1,33 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <SDL/SDL.h>
+
+// Player input for one simulation tick. Movement keys are sampled every
+// tick; E, S and L are presses and are set for the single tick after them.
+typedef Uint8 InputState;
+
+#define INPUT_LEFT    0x01
+#define INPUT_RIGHT   0x02
+#define INPUT_JUMP    0x04
+#define INPUT_ENTER   0x08   // E: take the subway
+#define INPUT_SAVE    0x10
+#define INPUT_LOAD    0x20
+
+// Recording file: magic, then version, tick rate and tick count as
+// little-endian 32-bit integers, then one entry per change of input: the
+// ticks since the previous change as a LEB128 varint and the new state.
+#define INPUT_MAGIC        "MMIR"
+#define INPUT_VERSION      1
+#define INPUT_HEADER_SIZE  16
+
+InputState input_from_keys(const Uint8* keystate);
+int  input_record(const char* path);
+int  input_replay(const char* path);
+int  input_replaying();
+int  input_recording();
+int  input_finished();
+InputState input_tick(InputState live);
+void input_close();
+
+#endif
@@ -0,0 +1,221 @@
+#include "loader.h"
+#include "game.h"
+#include <SDL/SDL_thread.h>
+#include <SDL/SDL_mutex.h>
+#include <stdio.h>
+
+typedef enum {
+    SLOT_EMPTY,
+    SLOT_QUEUED,     // Waiting for the loader thread
+    SLOT_LOADING,    // Being decoded right now
+    SLOT_READY,      // surface holds the composed background
+    SLOT_IN_USE,     // Handed out by loader_acquire
+    SLOT_FAILED
+} SlotState;
+
+typedef struct {
+    SlotState    state;
+    SDL_Surface* surface;
+    size_t       bytes;
+    Uint32       last_used;   // Value of use_clock when last touched
+} LevelSlot;
+
+static LevelSlot   slots[MAX_LEVELS];
+static size_t      budget         = (size_t)LEVEL_CACHE_BUDGET_MB * 1024 * 1024;
+static size_t      resident_bytes = 0;   // READY and IN_USE surfaces
+static Uint32      use_clock      = 0;
+static int         evictions      = 0;
+
+static SDL_Thread* thread = NULL;
+static SDL_mutex*  lock   = NULL;
+static SDL_cond*   wake   = NULL;   // Work queued or quitting
+static SDL_cond*   done   = NULL;   // A slot finished loading
+static int         quit   = 0;
+
+static void cache_lock()   { if (lock) SDL_LockMutex(lock); }
+static void cache_unlock() { if (lock) SDL_UnlockMutex(lock); }
+
+static size_t surface_bytes(SDL_Surface* s) {
+    return (size_t)s->pitch * s->h;
+}
+
+static int is_neighbor(int center, int level) {
+    if (level == center - 1 || level == center + 1) return 1;
+    // The subway links City3 and City4 in both directions
+    if ((center == 2 && level == 3) || (center == 3 && level == 2)) return 1;
+    return 0;
+}
+
+// Frees least recently used READY levels until the cache fits the budget.
+// Levels in use are never evicted, so the budget can be exceeded by them.
+// Called with the lock held.
+static void evict_to_budget() {
+    while (resident_bytes > budget) {
+        int victim = -1;
+        for (int i = 0; i < MAX_LEVELS; i++) {
+            if (slots[i].state == SLOT_READY &&
+                (victim < 0 || slots[i].last_used < slots[victim].last_used))
+                victim = i;
+        }
+        if (victim < 0) break;
+
+        SDL_FreeSurface(slots[victim].surface);
+        resident_bytes -= slots[victim].bytes;
+        slots[victim].surface = NULL;
+        slots[victim].bytes = 0;
+        slots[victim].state = SLOT_EMPTY;
+        evictions++;
+    }
+}
+
+static void store_slot(int level, SDL_Surface* s, SlotState state) {
+    slots[level].surface = s;
+    slots[level].bytes = surface_bytes(s);
+    slots[level].state = state;
+    slots[level].last_used = ++use_clock;
+    resident_bytes += slots[level].bytes;
+}
+
+static int loader_thread(void* unused) {
+    (void)unused;
+    SDL_LockMutex(lock);
+    while (!quit) {
+        int level = -1;
+        for (int i = 0; i < MAX_LEVELS; i++) {
+            if (slots[i].state == SLOT_QUEUED) {
+                level = i;
+                break;
+            }
+        }
+        if (level < 0) {
+            SDL_CondWait(wake, lock);
+            continue;
+        }
+
+        slots[level].state = SLOT_LOADING;
+        SDL_UnlockMutex(lock);
+        SDL_Surface* composed = compose_level(level);
+        SDL_LockMutex(lock);
+
+        if (composed) {
+            store_slot(level, composed, SLOT_READY);
+            evict_to_budget();
+        } else {
+            slots[level].state = SLOT_FAILED;
+        }
+        SDL_CondBroadcast(done);
+    }
+    SDL_UnlockMutex(lock);
+    return 0;
+}
+
+void init_loader() {
+    lock = SDL_CreateMutex();
+    wake = SDL_CreateCond();
+    done = SDL_CreateCond();
+    if (lock && wake && done)
+        thread = SDL_CreateThread(loader_thread, NULL);
+    if (!thread)
+        fprintf(stderr, "Level loader thread unavailable, loading levels synchronously: %s\n",
+                SDL_GetError());
+}
+
+void loader_set_budget(size_t bytes) {
+    cache_lock();
+    budget = bytes;
+    evict_to_budget();
+    cache_unlock();
+}
+
+void cleanup_loader() {
+    if (thread) {
+        SDL_LockMutex(lock);
+        quit = 1;
+        SDL_CondSignal(wake);
+        SDL_UnlockMutex(lock);
+        SDL_WaitThread(thread, NULL);
+        thread = NULL;
+    }
+    loader_report();
+    // IN_USE surfaces belong to the caller until released
+    for (int i = 0; i < MAX_LEVELS; i++) {
+        if (slots[i].state == SLOT_READY) SDL_FreeSurface(slots[i].surface);
+        slots[i].surface = NULL;
+        slots[i].bytes = 0;
+        slots[i].state = SLOT_EMPTY;
+    }
+    resident_bytes = 0;
+    if (done) SDL_DestroyCond(done);
+    if (wake) SDL_DestroyCond(wake);
+    if (lock) SDL_DestroyMutex(lock);
+    done = wake = NULL;
+    lock = NULL;
+}
+
+// Queues every level reachable from `level` that isn't resident yet.
+void loader_prefetch_neighbors(int level) {
+    if (!thread) return;
+
+    SDL_LockMutex(lock);
+    for (int i = 0; i < MAX_LEVELS; i++) {
+        if (!is_neighbor(level, i)) {
+            if (slots[i].state == SLOT_QUEUED) slots[i].state = SLOT_EMPTY;
+        } else if (slots[i].state == SLOT_EMPTY || slots[i].state == SLOT_FAILED) {
+            slots[i].state = SLOT_QUEUED;
+        }
+    }
+    SDL_CondSignal(wake);
+    SDL_UnlockMutex(lock);
+}
+
+// Returns the composed background for `level`, from the cache if it is
+// resident (waiting if the loader is decoding it right now), otherwise by
+// composing it on the calling thread. NULL if the level can't be loaded.
+SDL_Surface* loader_acquire(int level) {
+    cache_lock();
+    if (slots[level].state == SLOT_QUEUED)
+        slots[level].state = SLOT_EMPTY;   // Not started, cheaper to load here
+    while (slots[level].state == SLOT_LOADING)
+        SDL_CondWait(done, lock);
+    if (slots[level].state == SLOT_READY) {
+        slots[level].state = SLOT_IN_USE;
+        slots[level].last_used = ++use_clock;
+        SDL_Surface* s = slots[level].surface;
+        cache_unlock();
+        return s;
+    }
+    cache_unlock();
+
+    SDL_Surface* s = compose_level(level);
+    if (!s) return NULL;
+
+    cache_lock();
+    store_slot(level, s, SLOT_IN_USE);
+    evict_to_budget();
+    cache_unlock();
+    return s;
+}
+
+// Gives a background back to the cache once it is no longer on screen.
+void loader_release(int level, SDL_Surface* surface) {
+    cache_lock();
+    if (slots[level].state == SLOT_IN_USE && slots[level].surface == surface) {
+        slots[level].state = SLOT_READY;
+        slots[level].last_used = ++use_clock;
+        evict_to_budget();
+    } else {
+        SDL_FreeSurface(surface);
+    }
+    cache_unlock();
+}
+
+void loader_report() {
+    int count = 0;
+    cache_lock();
+    for (int i = 0; i < MAX_LEVELS; i++) {
+        if (slots[i].state == SLOT_READY || slots[i].state == SLOT_IN_USE) count++;
+    }
+    printf("Level cache: %d levels resident, %lu KB of %lu KB budget, %d evictions\n",
+           count, (unsigned long)(resident_bytes / 1024), (unsigned long)(budget / 1024), evictions);
+    cache_unlock();
+}
@@ -0,0 +1,23 @@
+#ifndef LOADER_H
+#define LOADER_H
+
+#include <SDL/SDL.h>
+
+// Composes level backgrounds from the loose layer files on a background
+// thread, ahead of the player. This is the fallback path only: when the
+// archive has a tileset, levels are drawn from tile chunks (tilemap.h),
+// nothing is composed, and init_game() never starts the loader.
+
+// LRU cache of composed backgrounds, also fallback only. Packed levels are
+// bounded by CHUNK_BUDGET_KB instead; --cache-mb sets whichever is in use.
+#define LEVEL_CACHE_BUDGET_MB 16   // Default; 6 levels at 800x600x32 need ~11 MB
+
+void init_loader();
+void loader_set_budget(size_t bytes);
+void cleanup_loader();
+void loader_prefetch_neighbors(int level);
+SDL_Surface* loader_acquire(int level);
+void loader_release(int level, SDL_Surface* surface);
+void loader_report();
+
+#endif
@@ -2,61 +2,140 @@
 #include "player.h"
 #include "objects.h"
 #include "minimap.h"
+#include "dirty.h"
+#include "loader.h"
+#include "pack.h"
+#include "checkpoint.h"
+#include "bench.h"
+#include "headless.h"
+#include "input.h"
+#include "clock.h"
+#include "profile.h"
+#include "present.h"
+#include "tilemap.h"
 #include <SDL/SDL.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
 
 int main(int argc, char* argv[]) {
+    int full_redraw = 0, headless = 0;
+    PresentMode present_mode = PRESENT_LIMIT;
+    int present_fps = PRESENT_DEFAULT_FPS;
+    long headless_ticks = HEADLESS_TICKS;
+    const char* record_path = NULL;
+    const char* replay_path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--full-redraw") == 0)
+            full_redraw = 1;
+        else if (strcmp(argv[i], "--cache-mb") == 0 && i + 1 < argc) {
+            // Only one of the two caches runs, depending on the archive
+            size_t bytes = (size_t)atoi(argv[++i]) * 1024 * 1024;
+            loader_set_budget(bytes);      // Composed levels, without an archive
+            tilemap_set_budget(bytes);     // Tile chunks, with one
+        }
+        else if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc)
+            return run_benchmark(argv[i + 1]);
+        else if (strcmp(argv[i], "--headless") == 0) {
+            headless = 1;
+            if (i + 1 < argc && isdigit((unsigned char)argv[i + 1][0]))
+                headless_ticks = atol(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+            record_path = argv[++i];
+        else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+            replay_path = argv[++i];
+        else if (strcmp(argv[i], "--time-scale") == 0 && i + 1 < argc)
+            clock_set_scale(atoi(argv[++i]));
+        else if (strcmp(argv[i], "--present") == 0 && i + 1 < argc) {
+            if (!present_parse_mode(argv[++i], &present_mode)) {
+                fprintf(stderr, "Unknown present mode '%s'. Available: vsync, limit, uncapped\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc)
+            present_fps = atoi(argv[++i]);
+    }
+    if (record_path && replay_path) {
+        fprintf(stderr, "--record and --replay can't be used together\n");
+        return 1;
+    }
+    if (replay_path && !input_replay(replay_path)) return 1;
+    if (record_path && !input_record(record_path)) return 1;
+
+    if (headless) return run_headless(headless_ticks);
+    dirty_init(!full_redraw);
+    present_configure(present_mode, present_fps);
+
     init_game();
 
-    SDL_Surface* playerSprite = IMG_Load("assets/player.png");
-    if (!playerSprite) {
-        fprintf(stderr, "Failed to load player.png: %s\n", IMG_GetError());
-        cleanup_game();
-        exit(1);
-    }
+    SDL_Surface* playerSprite = load_image(PLAYER_SHEET);
     SDL_SetColorKey(playerSprite, SDL_SRCCOLORKEY | SDL_RLEACCEL, SDL_MapRGB(playerSprite->format, 255, 255, 255));
-    playerSprite = SDL_DisplayFormat(playerSprite);
 
     init_player(&player, playerSprite);
     init_objects();
     init_minimap();
+    init_checkpoints();
+    init_profile();
 
     SDL_Event event;
+    Uint32 frames = 0, render_ms = 0;
+    InputState pressed = 0;   // Keypresses waiting for the next tick
+    int base_scale = clock_scale();
+    // Replays run one tick per frame, so every run simulates and renders
+    // the same frames on any machine
+    clock_set_lockstep(input_replaying());
+    // A replay starts from game time zero, as its recording did
+    if (input_replaying()) clock_reset();
     while (game.running) {
+        profile_begin(PROF_FRAME);
+        clock_frame(SDL_GetTicks());
+
         while(SDL_PollEvent(&event)) {
             if(event.type == SDL_QUIT)
                 game.running = 0;
             else if (event.type == SDL_KEYDOWN) {
                 if(event.key.keysym.sym == SDLK_s)
-                    save_game();
+                    pressed |= INPUT_SAVE;
                 else if(event.key.keysym.sym == SDLK_l)
-                    load_game();
-                else if(event.key.keysym.sym == SDLK_e) {
-                    if(current_level == 2) { // City3 subway entrance
-                        SDL_Rect subwayArea = {545, 450, 50, 50};
-                        if (check_collision(player.position, subwayArea)) {
-                            load_level(3);
-                        }
-                    }
-                    else if(current_level == 3) { // City4 subway exit
-                        SDL_Rect exitSubwayArea = {380, 465, 50, 50};
-                        if (check_collision(player.position, exitSubwayArea)) {
-                            load_level(2);
-                        }
-                    }
-                }
+                    pressed |= INPUT_LOAD;
+                else if(event.key.keysym.sym == SDLK_e)
+                    pressed |= INPUT_ENTER;
+                else if(event.key.keysym.sym == SDLK_p)
+                    clock_set_paused(!clock_paused());
+                else if(event.key.keysym.sym == SDLK_f)
+                    clock_set_scale(clock_scale() == CLOCK_SCALE_FAST ? base_scale : CLOCK_SCALE_FAST);
+                else if(event.key.keysym.sym == SDLK_F3)
+                    profile_toggle_hud();
             }
         }
 
-        const Uint8* keystate = SDL_GetKeyState(NULL);
-        handle_input_player(&player, keystate);
-        update_player(&player); 
-        update_objects();
-        update_game();
-        SDL_Flip(game.screen);
-        SDL_Delay(16);
+        // Run the simulation in fixed steps, then render whatever is left
+        // of the step as an interpolation factor between the last two states.
+        while (clock_step_due()) {
+            InputState live = input_from_keys(SDL_GetKeyState(NULL)) | pressed;
+            pressed = 0;
+            step_game(input_tick(live));
+        }
+        if (input_finished()) game.running = 0;
+
+        Uint32 render_start = SDL_GetTicks();
+        update_game(clock_alpha());
+        render_ms += SDL_GetTicks() - render_start;
+        if (frames == 0)
+            printf("First frame after %u ms\n", (unsigned)SDL_GetTicks());
+        frames++;
+        profile_end(PROF_FRAME);
+        profile_frame();
+        present_pace();
+    }
+
+    if (frames > 0) {
+        printf("Rendered %u frames, average frame time %.3f ms\n",
+               (unsigned)frames, render_ms / (double)frames);
     }
+    present_report();
 
     cleanup_game();
     return 0;
@@ -2,108 +2,235 @@
 #include "game.h"
 #include "player.h"
 #include "objects.h"
+#include "dirty.h"
+#include "pack.h"
+#include "sprite.h"
 #include <stdio.h>
 #include <stdlib.h>
 
-SDL_Surface *minimap_bg = NULL;
 SDL_Surface *player_icon = NULL;
 SDL_Surface *platform_icon = NULL;
 SDL_Surface *coin_icon = NULL;
 
-SDL_Rect minimap_rect = {SCREEN_WIDTH - 228, 10, 150, 100};
-const float SCALE = 0.2f;
+SDL_Rect minimap_rect = {SCREEN_WIDTH - 228, 10, MINIMAP_WIDTH, MINIMAP_HEIGHT};
+// The whole level fits the minimap: 1:16 across, 1:6 down
+#define SCALE_DIV_X (WORLD_WIDTH / MINIMAP_WIDTH)
+#define SCALE_DIV_Y (SCREEN_HEIGHT / MINIMAP_HEIGHT)
 
-void init_minimap() {
-    printf("Initializing minimap...\n");
-    SDL_Surface* temp = IMG_Load("assets/minimap.jpg");
-    if (!temp) {
-        fprintf(stderr, "Failed to load minimap.png: %s\n", IMG_GetError());
-        cleanup_game();
-        exit(1);
+// Generated backgrounds, one per level
+static SDL_Surface* level_maps[MAX_LEVELS];
+static int          level_tried[MAX_LEVELS];   // Don't retry a level that failed
+
+// Icons pre-scaled to the marker sizes in use, so a plain blit draws them
+// at the right size. Every entity of a type has the same size, so a few
+// entries cover the game.
+typedef struct {
+    SDL_Surface* icon;
+    int          w, h;
+    SDL_Surface* scaled;
+} SizedIcon;
+
+static SizedIcon sized_icons[MINIMAP_ICON_SIZES];
+static int       sized_count = 0;
+
+static SDL_Surface* composite = NULL;       // Background plus static markers
+static int          composite_level = -1;
+static int          composite_stale = 1;
+
+// World-space fixed point to whole minimap pixels
+static int to_minimap(fixed_t v, int div) {
+    return FIX_TO_INT(v / div);
+}
+
+// `icon` scaled to w x h, made on first use and kept until cleanup. Falls
+// back to the unscaled icon if it can't be made or the table is full.
+static SDL_Surface* sized_icon(SDL_Surface* icon, int w, int h) {
+    if (w < 1) w = 1;
+    if (h < 1) h = 1;
+    if (icon->w == w && icon->h == h) return icon;
+    for (int i = 0; i < sized_count; i++) {
+        if (sized_icons[i].icon == icon && sized_icons[i].w == w && sized_icons[i].h == h)
+            return sized_icons[i].scaled;
     }
-    minimap_bg = SDL_DisplayFormat(temp);
-    SDL_FreeSurface(temp);
-    if (!minimap_bg) {
-        fprintf(stderr, "Failed to convert minimap background\n");
-        cleanup_game();
-        exit(1);
+    if (sized_count == MINIMAP_ICON_SIZES) return icon;
+
+    SDL_Surface* s = sprite_scaled(icon, w, h);
+    if (!s) {
+        fprintf(stderr, "Failed to scale a minimap icon to %dx%d\n", w, h);
+        return icon;
     }
-    
-    temp = IMG_Load("assets/minimap_player.jpg");
-    if (!temp) {
-        fprintf(stderr, "Failed to load minimap_player.png: %s\n", IMG_GetError());
-        cleanup_game();
-        exit(1);
+    SizedIcon e = {icon, w, h, s};
+    sized_icons[sized_count++] = e;
+    return s;
+}
+
+void init_minimap() {
+    printf("Initializing minimap...\n");
+    player_icon = load_image("assets/minimap_player.jpg");
+    platform_icon = load_image("assets/minimap_platform.png");
+    coin_icon = load_image("assets/minimap_coin.png");
+    // The player's size is fixed; platforms and coins are sized as their
+    // level loads
+    sized_icon(player_icon, to_minimap(player.body.w, SCALE_DIV_X), to_minimap(player.body.h, SCALE_DIV_Y));
+    minimap_load_level(current_level);   // The first level loaded before the icons
+}
+
+// The level key only covers one screen of a level, so everything else
+// that shapes the result is part of the name too
+static void cache_path(char* path, size_t n, Uint32 key) {
+    snprintf(path, n, MINIMAP_CACHE_PATH, (unsigned)key, MINIMAP_WIDTH, MINIMAP_HEIGHT,
+             WORLD_WIDTH, SCALE_DIV_X, SCALE_DIV_Y);
+}
+
+static SDL_Surface* load_cached(Uint32 key) {
+    char path[64];
+    cache_path(path, sizeof(path), key);
+    SDL_Surface* bmp = SDL_LoadBMP(path);
+    if (!bmp) return NULL;
+    SDL_Surface* s = NULL;
+    if (bmp->w == MINIMAP_WIDTH && bmp->h == MINIMAP_HEIGHT)
+        s = SDL_DisplayFormat(bmp);
+    SDL_FreeSurface(bmp);
+    return s;
+}
+
+// Box-filters the composed level down to the minimap, then keeps the
+// result on disk under the level's cache key.
+static SDL_Surface* build_level_map(int level, Uint32 key) {
+    Uint32 start = SDL_GetTicks();
+    SDL_Surface* world = compose_world(level);
+    if (!world) return NULL;
+    SDL_Surface* s = sprite_downsampled(world, SCALE_DIV_X, SCALE_DIV_Y);
+    SDL_FreeSurface(world);
+    if (!s) {
+        fprintf(stderr, "Failed to build the minimap for level %d\n", level + 1);
+        return NULL;
     }
-    player_icon = SDL_DisplayFormat(temp);
-    SDL_FreeSurface(temp);
-    if (!player_icon) {
-        fprintf(stderr, "Failed to convert player icon\n");
-        cleanup_game();
-        exit(1);
+    printf("Built minimap for level %d in %u ms\n", level + 1, (unsigned)(SDL_GetTicks() - start));
+
+    if (key) {
+        char path[64];
+        cache_path(path, sizeof(path), key);
+        if (SDL_SaveBMP(s, path) != 0)
+            fprintf(stderr, "Failed to cache %s: %s\n", path, SDL_GetError());
     }
-    
-    temp = IMG_Load("assets/minimap_platform.png");
-    if (!temp) {
-        fprintf(stderr, "Failed to load minimap_platform.png: %s\n", IMG_GetError());
-        cleanup_game();
-        exit(1);
+    return s;
+}
+
+// Background for a level: from memory, else the disk cache, else built.
+// A level's content can't change while the game runs, so it is keyed
+// only the first time the level is loaded.
+static SDL_Surface* level_map(int level) {
+    if (level_maps[level] || level_tried[level]) return level_maps[level];
+    level_tried[level] = 1;
+
+    Uint32 key = level_cache_key(level);
+    SDL_Surface* s = key ? load_cached(key) : NULL;
+    if (!s) s = build_level_map(level, key);
+    level_maps[level] = s;
+    return s;
+}
+
+void cleanup_minimap() {
+    if (composite) SDL_FreeSurface(composite);
+    composite = NULL;
+    for (int i = 0; i < sized_count; i++)
+        SDL_FreeSurface(sized_icons[i].scaled);
+    sized_count = 0;
+    for (int i = 0; i < MAX_LEVELS; i++) {
+        if (level_maps[i]) SDL_FreeSurface(level_maps[i]);
+        level_maps[i] = NULL;
+        level_tried[i] = 0;
     }
-    platform_icon = SDL_DisplayFormat(temp);
-    SDL_FreeSurface(temp);
-    if (!platform_icon) {
-        fprintf(stderr, "Failed to convert platform icon\n");
-        cleanup_game();
-        exit(1);
+}
+
+// Position and scaled size of an entity's marker, relative to the minimap
+static SDL_Rect entity_marker(int i) {
+    SDL_Rect r = {
+        (Sint16)to_minimap(entities.x[i], SCALE_DIV_X),
+        (Sint16)to_minimap(entities.y[i], SCALE_DIV_Y),
+        (Uint16)to_minimap(entities.w[i], SCALE_DIV_X),
+        (Uint16)to_minimap(entities.h[i], SCALE_DIV_Y)
+    };
+    return r;
+}
+
+// Level background with the markers that never move (platforms, coins)
+// baked in. Built when a level loads and again after minimap_invalidate().
+static SDL_Surface* build_composite() {
+    SDL_PixelFormat* fmt = game.screen->format;
+    SDL_Surface* s = SDL_CreateRGBSurface(SDL_SWSURFACE, MINIMAP_WIDTH, MINIMAP_HEIGHT, fmt->BitsPerPixel,
+                                          fmt->Rmask, fmt->Gmask, fmt->Bmask, 0);
+    if (!s) {
+        fprintf(stderr, "Failed to create minimap composite: %s\n", SDL_GetError());
+        return NULL;
     }
-    
-    temp = IMG_Load("assets/minimap_coin.png");
-    if (!temp) {
-        fprintf(stderr, "Failed to load minimap_coin.png: %s\n", IMG_GetError());
-        cleanup_game();
-        exit(1);
+    SDL_Surface* bg = level_map(current_level);
+    if (bg) SDL_BlitSurface(bg, NULL, s, NULL);
+
+    for (int i = 0; i < entities.count; i++) {
+        SDL_Surface* icon = NULL;
+        if (entities.type[i] == ENTITY_PLATFORM) icon = platform_icon;
+        else if (entities.type[i] == ENTITY_COIN) icon = coin_icon;
+        if (!icon) continue;
+
+        SDL_Rect icon_pos = entity_marker(i);
+        SDL_BlitSurface(sized_icon(icon, icon_pos.w, icon_pos.h), NULL, s, &icon_pos);
     }
-    coin_icon = SDL_DisplayFormat(temp);
-    SDL_FreeSurface(temp);
-    if (!coin_icon) {
-        fprintf(stderr, "Failed to convert coin icon\n");
-        cleanup_game();
-        exit(1);
+    composite_level = current_level;
+    return s;
+}
+
+// Call when a level's static markers change: a level load or a coin taken
+void minimap_invalidate() {
+    composite_stale = 1;
+}
+
+static void refresh_composite() {
+    if (composite) SDL_FreeSurface(composite);
+    composite = build_composite();
+    composite_stale = 0;
+}
+
+// Builds the level's map, its marker icons and the composite while the
+// level loads, so its first frame only blits. Does nothing before init_minimap() or when headless.
+void minimap_load_level(int level) {
+    if (!player_icon) return;
+    level_map(level);
+    for (int i = 0; i < entities.count; i++) {
+        SDL_Rect r = entity_marker(i);
+        if (entities.type[i] == ENTITY_PLATFORM) sized_icon(platform_icon, r.w, r.h);
+        else if (entities.type[i] == ENTITY_COIN) sized_icon(coin_icon, r.w, r.h);
     }
+    refresh_composite();
 }
 
 void draw_minimap() {
-    SDL_BlitSurface(minimap_bg, NULL, game.screen, &minimap_rect);
-    
-    // Draw player icon
+    // After a coin pickup; only re-blits, the map itself is already built
+    if (composite_stale || composite_level != current_level || !composite)
+        refresh_composite();
+
+    SDL_Rect bg_pos = minimap_rect;
+    if (composite) SDL_BlitSurface(composite, NULL, game.screen, &bg_pos);
+    dirty_mark(bg_pos);
+
+    // Only the markers that move are drawn every frame
+    Uint32 obstacle_color = SDL_MapRGB(game.screen->format, 200, 60, 60);
+    for (int i = 0; i < entities.count; i++) {
+        if (entities.type[i] != ENTITY_OBSTACLE) continue;
+        SDL_Rect o_pos = entity_marker(i);
+        o_pos.x += minimap_rect.x;
+        o_pos.y += minimap_rect.y;
+        SDL_FillRect(game.screen, &o_pos, obstacle_color);
+        dirty_mark(o_pos);
+    }
+
     SDL_Rect p_pos = {
-        minimap_rect.x + (int)(player.position.x * SCALE),
-        minimap_rect.y + (int)(player.position.y * SCALE),
-        (int)(player.position.w * SCALE),
-        (int)(player.position.h * SCALE)
+        minimap_rect.x + to_minimap(player.body.x, SCALE_DIV_X),
+        minimap_rect.y + to_minimap(player.body.y, SCALE_DIV_Y),
+        to_minimap(player.body.w, SCALE_DIV_X),
+        to_minimap(player.body.h, SCALE_DIV_Y)
     };
-    SDL_BlitSurface(player_icon, NULL, game.screen, &p_pos);
-    
-    // Draw platform icon
-    if (platform.active && platform_icon) {
-        SDL_Rect plat_pos = {
-            minimap_rect.x + (int)(platform.position.x * SCALE),
-            minimap_rect.y + (int)(platform.position.y * SCALE),
-            (int)(platform.position.w * SCALE),
-            (int)(platform.position.h * SCALE)
-        };
-        SDL_BlitSurface(platform_icon, NULL, game.screen, &plat_pos);
-    }
-    
-    // Draw coin icon
-    if (coin.active && coin_icon) {
-        SDL_Rect coin_pos = {
-            minimap_rect.x + (int)(coin.position.x * SCALE),
-            minimap_rect.y + (int)(coin.position.y * SCALE),
-            (int)(coin.position.w * SCALE),
-            (int)(coin.position.h * SCALE)
-        };
-        SDL_BlitSurface(coin_icon, NULL, game.screen, &coin_pos);
-    }
+    SDL_BlitSurface(sized_icon(player_icon, p_pos.w, p_pos.h), NULL, game.screen, &p_pos);
+    dirty_mark(p_pos);
 }
-
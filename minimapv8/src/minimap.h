@@ -5,8 +5,17 @@
 #include <SDL/SDL_image.h>
 #include "game.h"
 
+#define MINIMAP_WIDTH      150
+#define MINIMAP_HEIGHT     100
+#define MINIMAP_ICON_SIZES 8   // Pre-scaled icon variants kept
+// Level cache key, minimap size, world width, filter divisors
+#define MINIMAP_CACHE_PATH "minimap_%08x_%dx%d_w%d_f%dx%d.bmp"
+
 void init_minimap();
 void draw_minimap();
+void minimap_invalidate();
+void minimap_load_level(int level);
+void cleanup_minimap();
 
 #endif
 
@@ -1,163 +1,383 @@
 #include "objects.h"
 #include "player.h"
 #include "game.h"
+#include "dirty.h"
+#include "pack.h"
+#include "spatial.h"
+#include "camera.h"
+#include "minimap.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
-GameObject platform;
-GameObject coin;
-GameObject obstacle;
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+typedef struct {
+    int type;
+    int x, y, w, h;           // y/w/h of 0 use the type's default
+    int target;               // Triggers: level to go to
+    const char* prompt;       // Triggers: text shown above the area
+} EntitySpawn;
+
+// What each level places, by world x position (levels are WORLD_WIDTH
+// wide). Terminated by a zero x.
+static const EntitySpawn level_spawns[MAX_LEVELS][MAX_SPAWNS_PER_LEVEL] = {
+    { {ENTITY_PLATFORM, 300}, {ENTITY_COIN, 600}, {ENTITY_OBSTACLE, 500},
+      {ENTITY_PLATFORM, 1050}, {ENTITY_OBSTACLE, 1300},
+      {ENTITY_PLATFORM, 1900}, {ENTITY_OBSTACLE, 2100} },
+    { {ENTITY_PLATFORM, 100}, {ENTITY_COIN, 400}, {ENTITY_OBSTACLE, 200},
+      {ENTITY_PLATFORM, 1200}, {ENTITY_OBSTACLE, 1000},
+      {ENTITY_PLATFORM, 1750}, {ENTITY_OBSTACLE, 2000} },
+    { {ENTITY_COIN, 200},     // City3: the subway level has no platform or obstacle
+      {ENTITY_TRIGGER, 545, 450, 50, 50, 3, "PRESS E TO ENTER SUBWAY"} },
+    { {ENTITY_PLATFORM, 150}, {ENTITY_COIN, 700}, {ENTITY_OBSTACLE, 400},
+      {ENTITY_TRIGGER, 380, 465, 50, 50, 2, "PRESS E TO LEAVE SUBWAY"},
+      {ENTITY_PLATFORM, 1100}, {ENTITY_OBSTACLE, 1450},
+      {ENTITY_PLATFORM, 2000}, {ENTITY_OBSTACLE, 1750} },
+    { {ENTITY_PLATFORM, 250}, {ENTITY_COIN, 550}, {ENTITY_OBSTACLE, 350},
+      {ENTITY_PLATFORM, 1000}, {ENTITY_OBSTACLE, 1250},
+      {ENTITY_PLATFORM, 1850}, {ENTITY_OBSTACLE, 1600} },
+    { {ENTITY_PLATFORM, 600}, {ENTITY_COIN, 100}, {ENTITY_OBSTACLE, 300},
+      {ENTITY_PLATFORM, 1300}, {ENTITY_OBSTACLE, 1050},
+      {ENTITY_PLATFORM, 2050}, {ENTITY_OBSTACLE, 1800} },
+};
+
+EntityStore entities;
+
+// Handle slots. A live slot maps to its index in `entities`; free slots
+// form a linked list through next_free.
+static Uint16 generation[MAX_ENTITIES];
+static int    slot_index[MAX_ENTITIES];
+static int    next_free[MAX_ENTITIES];
+static int    free_head = -1;
+
+static SpatialHash world_hash;   // Broad phase over `entities`, by index
+static SDL_Surface* type_sprites[ENTITY_TYPE_COUNT];
+static int          platform_w, platform_h;   // Collision size, from the sprite
+static SDL_Rect     flashRect;   // Where the last collected coin was
 
 int check_collision(SDL_Rect a, SDL_Rect b) {
     return !(a.x + a.w < b.x || a.x > b.x + b.w || a.y + a.h < b.y || a.y > b.y + b.h);
 }
 
+void entity_clear() {
+    // Handles to anything still alive must go stale, like on destroy
+    for (int i = 0; i < entities.count; i++)
+        generation[entities.slot[i]]++;
+    entities.count = 0;
+    free_head = -1;
+    for (int i = MAX_ENTITIES - 1; i >= 0; i--) {
+        next_free[i] = free_head;
+        free_head = i;
+    }
+}
+
+EntityHandle entity_create(int type) {
+    if (free_head < 0) {
+        fprintf(stderr, "Entity pool full, raise MAX_ENTITIES\n");
+        return INVALID_ENTITY;
+    }
+    int slot = free_head;
+    free_head = next_free[slot];
+
+    int i = entities.count++;
+    entities.x[i] = entities.y[i] = entities.w[i] = entities.h[i] = 0;
+    entities.prev_x[i] = entities.prev_y[i] = 0;
+    entities.velocityX[i] = 0;
+    entities.leftLimit[i] = entities.rightLimit[i] = 0;
+    entities.frame[i] = 0;
+    entities.max_frame[i] = 1;
+    entities.type[i] = type;
+    entities.spawn_id[i] = -1;
+    entities.target[i] = -1;
+    entities.prompt[i] = NULL;
+    entities.sprite[i] = type_sprites[type];
+    entities.slot[i] = (Uint16)slot;
+    slot_index[slot] = i;
+    return ((Uint32)generation[slot] << 16) | (Uint32)slot;
+}
+
+// Index of a live entity, or -1 if the handle is stale
+int entity_index(EntityHandle h) {
+    int slot = h & 0xFFFF;
+    if (h == INVALID_ENTITY || slot >= MAX_ENTITIES || generation[slot] != (h >> 16)) return -1;
+    return slot_index[slot];
+}
+
+EntityHandle entity_handle(int i) {
+    int slot = entities.slot[i];
+    return ((Uint32)generation[slot] << 16) | (Uint32)slot;
+}
+
+// Moves the last entity into the destroyed one's index, so loops that
+// destroy should iterate backwards.
+void entity_destroy(EntityHandle h) {
+    int i = entity_index(h);
+    if (i < 0) return;
+    int slot = h & 0xFFFF;
+    int last = --entities.count;
+
+    if (i != last) {
+        entities.x[i] = entities.x[last];
+        entities.y[i] = entities.y[last];
+        entities.w[i] = entities.w[last];
+        entities.h[i] = entities.h[last];
+        entities.prev_x[i] = entities.prev_x[last];
+        entities.prev_y[i] = entities.prev_y[last];
+        entities.velocityX[i] = entities.velocityX[last];
+        entities.leftLimit[i] = entities.leftLimit[last];
+        entities.rightLimit[i] = entities.rightLimit[last];
+        entities.frame[i] = entities.frame[last];
+        entities.max_frame[i] = entities.max_frame[last];
+        entities.type[i] = entities.type[last];
+        entities.spawn_id[i] = entities.spawn_id[last];
+        entities.target[i] = entities.target[last];
+        entities.prompt[i] = entities.prompt[last];
+        entities.sprite[i] = entities.sprite[last];
+        entities.slot[i] = entities.slot[last];
+        slot_index[entities.slot[i]] = i;
+    }
+
+    generation[slot]++;
+    next_free[slot] = free_head;
+    free_head = slot;
+}
+
+FixRect entity_body(int i) {
+    FixRect r = {entities.x[i], entities.y[i], entities.w[i], entities.h[i]};
+    return r;
+}
+
+SDL_Rect entity_rect(int i) {
+    return fix_to_rect(entity_body(i));
+}
+
+SDL_Rect entity_prev_rect(int i) {
+    FixRect r = {entities.prev_x[i], entities.prev_y[i], entities.w[i], entities.h[i]};
+    return fix_to_rect(r);
+}
+
+// Moves every entity by its velocity and reverses the ones that reached a
+// patrol limit. Entities that don't patrol have zero velocity.
+void patrol_entities(fixed_t* x, fixed_t* velocityX, const fixed_t* w, const fixed_t* leftLimit,
+                     const fixed_t* rightLimit, int n) {
+    int i = 0;
+#if defined(__SSE2__)
+    const __m128i ones = _mm_set1_epi32(-1);
+    for (; i + 4 <= n; i += 4) {
+        __m128i vx  = _mm_loadu_si128((const __m128i*)(velocityX + i));
+        __m128i px  = _mm_add_epi32(_mm_loadu_si128((const __m128i*)(x + i)), vx);
+        __m128i right_edge = _mm_add_epi32(px, _mm_loadu_si128((const __m128i*)(w + i)));
+
+        // bounce = x <= leftLimit || x + w >= rightLimit
+        __m128i inside = _mm_and_si128(
+            _mm_cmpgt_epi32(px, _mm_loadu_si128((const __m128i*)(leftLimit + i))),
+            _mm_cmpgt_epi32(_mm_loadu_si128((const __m128i*)(rightLimit + i)), right_edge));
+        __m128i bounce = _mm_xor_si128(inside, ones);
+
+        // Negate where bounce is all ones: (v ^ -1) - (-1) == -v
+        vx = _mm_sub_epi32(_mm_xor_si128(vx, bounce), bounce);
+        _mm_storeu_si128((__m128i*)(x + i), px);
+        _mm_storeu_si128((__m128i*)(velocityX + i), vx);
+    }
+#endif
+    for (; i < n; i++) {
+        x[i] += velocityX[i];
+        if (x[i] <= leftLimit[i] || x[i] + w[i] >= rightLimit[i])
+            velocityX[i] = -velocityX[i];
+    }
+}
+
+// Steps every animation by one frame, wrapping at max_frame
+void animate_entities(Sint32* frame, const Sint32* max_frame, int n) {
+    int i = 0;
+#if defined(__SSE2__)
+    const __m128i one = _mm_set1_epi32(1);
+    for (; i + 4 <= n; i += 4) {
+        __m128i f    = _mm_loadu_si128((const __m128i*)(frame + i));
+        __m128i next = _mm_add_epi32(f, one);
+        __m128i keep = _mm_cmpgt_epi32(_mm_loadu_si128((const __m128i*)(max_frame + i)), next);
+        _mm_storeu_si128((__m128i*)(frame + i), _mm_and_si128(next, keep));
+    }
+#endif
+    for (; i < n; i++) {
+        frame[i] = (frame[i] + 1 < max_frame[i]) ? frame[i] + 1 : 0;
+    }
+}
+
+// Entity indices change on create/destroy, so the hash is rebuilt after
+// those and after everything has moved each tick.
+static void rebuild_world_hash() {
+    spatial_clear(&world_hash);
+    for (int i = 0; i < entities.count; i++) {
+        if (!spatial_insert(&world_hash, i, entity_rect(i))) {
+            fprintf(stderr, "World hash full, entity %d not indexed\n", i);
+            break;
+        }
+    }
+}
+
+// Indices of entities that may overlap r (broad phase only)
+int objects_near(SDL_Rect r, int* out, int max_out) {
+    return spatial_query(&world_hash, r, out, max_out);
+}
+
+// Index of a trigger overlapping r, or -1
+int find_trigger(SDL_Rect r) {
+    int near[MAX_NEARBY];
+    int n = objects_near(r, near, MAX_NEARBY);
+    for (int k = 0; k < n; k++) {
+        int i = near[k];
+        if (entities.type[i] == ENTITY_TRIGGER && check_collision(r, entity_rect(i)))
+            return i;
+    }
+    return -1;
+}
+
+static void spawn(const EntitySpawn* s, int spawn_id) {
+    int i = entity_index(entity_create(s->type));
+    if (i < 0) return;
+    entities.spawn_id[i] = spawn_id;
+    entities.x[i] = INT_TO_FIX(s->x);
+
+    switch (s->type) {
+        case ENTITY_PLATFORM:
+            entities.y[i] = INT_TO_FIX(GROUND_LEVEL - platform_h);
+            entities.w[i] = INT_TO_FIX(platform_w);
+            entities.h[i] = INT_TO_FIX(platform_h);
+            break;
+        case ENTITY_COIN:
+            entities.y[i] = INT_TO_FIX(GROUND_LEVEL - 200);
+            entities.w[i] = INT_TO_FIX(32);
+            entities.h[i] = INT_TO_FIX(32);
+            entities.max_frame[i] = 4;
+            break;
+        case ENTITY_OBSTACLE:
+            entities.y[i] = INT_TO_FIX(GROUND_LEVEL - 150);
+            entities.w[i] = INT_TO_FIX(50);
+            entities.h[i] = INT_TO_FIX(50);
+            entities.leftLimit[i] = entities.x[i] - INT_TO_FIX(75);
+            entities.rightLimit[i] = entities.x[i] + INT_TO_FIX(170);
+            entities.velocityX[i] = OBSTACLE_SPEED;
+            break;
+        case ENTITY_TRIGGER:
+            entities.target[i] = s->target;
+            entities.prompt[i] = s->prompt;
+            break;
+    }
+    if (s->y) entities.y[i] = INT_TO_FIX(s->y);
+    if (s->w) entities.w[i] = INT_TO_FIX(s->w);
+    if (s->h) entities.h[i] = INT_TO_FIX(s->h);
+    entities.prev_x[i] = entities.x[i];
+    entities.prev_y[i] = entities.y[i];
+}
+
 void init_objects() {
     static int first_time = 1;
-    SDL_Surface* temp;
 
     if(first_time) {
-        temp = IMG_Load("assets/platform.png");
-        if (!temp) {
-            fprintf(stderr, "Failed to load platform.png: %s\n", IMG_GetError());
-            cleanup_game();
-            exit(1);
-        }
-        platform.sprite = SDL_DisplayFormat(temp);
-        SDL_FreeSurface(temp);
-
-        temp = IMG_Load("assets/coin.png");
-        if (!temp) {
-            fprintf(stderr, "Failed to load coin.png: %s\n", IMG_GetError());
-            cleanup_game();
-            exit(1);
+        if (game.headless) {
+            // Nothing is drawn; only the platform size matters
+            if (!image_size("assets/platform.png", &platform_w, &platform_h)) {
+                fprintf(stderr, "Failed to read the size of assets/platform.png\n");
+                cleanup_game();
+                exit(1);
+            }
+        } else {
+            type_sprites[ENTITY_PLATFORM] = load_image("assets/platform.png");
+            type_sprites[ENTITY_COIN] = load_image_keyed_alpha("assets/coin.png", 0, 0, 0);
+            type_sprites[ENTITY_OBSTACLE] = load_image("assets/obstacle.jpg");
+            platform_w = type_sprites[ENTITY_PLATFORM]->w;
+            platform_h = type_sprites[ENTITY_PLATFORM]->h;
         }
-        SDL_SetColorKey(temp, SDL_SRCCOLORKEY, SDL_MapRGB(temp->format, 0, 0, 0));
-        coin.sprite = SDL_DisplayFormatAlpha(temp);
-        SDL_FreeSurface(temp);
-        coin.max_frame = 4;
-
-        temp = IMG_Load("assets/obstacle.jpg");
-        if (!temp) {
-            fprintf(stderr, "Failed to load obstacle.jpg: %s\n", IMG_GetError());
+        if (!spatial_init(&world_hash, WORLD_CELL_SHIFT, 1024, MAX_ENTITIES, MAX_ENTITIES * 16)) {
+            fprintf(stderr, "Failed to allocate the world hash\n");
             cleanup_game();
             exit(1);
         }
-        obstacle.sprite = SDL_DisplayFormat(temp);
-        SDL_FreeSurface(temp);
 
         first_time = 0;
     }
 
-    switch(current_level) {
-        case 0:
-            platform.position.x = 300;
-            coin.position.x = 600;
-            obstacle.position.x = 500;
-            platform.active = 1;
-            obstacle.active = 1;
-            break;
-        case 1:
-            platform.position.x = 100;
-            coin.position.x = 400;
-            obstacle.position.x = 200;
-            platform.active = 1;
-            obstacle.active = 1;
-            break;
-        case 2:
-            platform.position.x = 500;
-            coin.position.x = 200;
-            obstacle.position.x = 600;
-            platform.active = 0;
-            obstacle.active = 0;
-            break;
-        case 3:
-            platform.position.x = 150;
-            coin.position.x = 700;
-            obstacle.position.x = 400;
-            platform.active = 1;
-            obstacle.active = 1;
-            break;
-        case 4:
-            platform.position.x = 250;
-            coin.position.x = 550;
-            obstacle.position.x = 350;
-            platform.active = 1;
-            obstacle.active = 1;
-            break;
-        case 5:
-            platform.position.x = 600;
-            coin.position.x = 100;
-            obstacle.position.x = 300;
-            platform.active = 1;
-            obstacle.active = 1;
-            break;
+    entity_clear();
+    const EntitySpawn* spawns = level_spawns[current_level];
+    for (int i = 0; i < MAX_SPAWNS_PER_LEVEL && spawns[i].x != 0; i++) {
+        if (spawns[i].type == ENTITY_COIN && game.collected_coins[current_level])
+            continue;
+        spawn(&spawns[i], i);
     }
+    rebuild_world_hash();
+}
 
-    coin.active = !game.collected_coins[current_level];
-    
-    platform.position.y = GROUND_LEVEL - platform.sprite->h;
-    platform.position.w = platform.sprite->w;
-    platform.position.h = platform.sprite->h;
-    
-    coin.position.y = GROUND_LEVEL - 200;
-    coin.position.w = 32;
-    coin.position.h = 32;
-    coin.frame = 0;
-    
-    obstacle.position.y = GROUND_LEVEL - 150;
-    obstacle.position.w = 50;
-    obstacle.position.h = 50;
-    obstacle.leftLimit = obstacle.position.x - 75;
-    obstacle.rightLimit = obstacle.position.x + 170;
-    obstacle.velocityX = 2;
-}
-
-void update_objects() {
-    if (coin.active) {
-        static Uint32 last = 0;
-        Uint32 now = SDL_GetTicks();
-        if (now - last > 100) {
-            coin.frame = (coin.frame + 1) % coin.max_frame;
-            last = now;
-        }
-        if (check_collision(player.position, coin.position)) {
-            coin.active = 0;
+void snapshot_objects() {
+    memcpy(entities.prev_x, entities.x, entities.count * sizeof(fixed_t));
+    memcpy(entities.prev_y, entities.y, entities.count * sizeof(fixed_t));
+}
+
+void update_objects(Uint32 now) {
+    static Uint32 last = 0;
+    if (now - last > 100) {
+        animate_entities(entities.frame, entities.max_frame, entities.count);
+        last = now;
+    }
+    patrol_entities(entities.x, entities.velocityX, entities.w, entities.leftLimit,
+                    entities.rightLimit, entities.count);
+
+    rebuild_world_hash();
+
+    int near[MAX_NEARBY];
+    EntityHandle collected[MAX_NEARBY];
+    int n = objects_near(player.position, near, MAX_NEARBY), ncollected = 0;
+    for (int k = 0; k < n; k++) {
+        int i = near[k];
+        if (entities.type[i] != ENTITY_COIN) continue;
+        SDL_Rect r = entity_rect(i);
+        if (check_collision(player.position, r)) {
             game.collected_coins[current_level] = 1;
-            game.score += 1;         
+            game.score += 1;
             flashBackground = 1;
             flashStartTime = now;
+            flashRect = r;
+            collected[ncollected++] = entity_handle(i);
         }
     }
-
-    if (obstacle.active) {
-        obstacle.position.x += obstacle.velocityX;
-        if (obstacle.position.x <= obstacle.leftLimit || obstacle.position.x + obstacle.position.w >= obstacle.rightLimit) {
-            obstacle.velocityX = -obstacle.velocityX;
-        }
+    // Destroy by handle afterwards, since destroying moves indices around
+    for (int k = 0; k < ncollected; k++)
+        entity_destroy(collected[k]);
+    if (ncollected) {
+        rebuild_world_hash();
+        minimap_invalidate();
     }
 }
 
-void draw_objects() {
-    if (platform.active && platform.sprite) {
-        SDL_BlitSurface(platform.sprite, NULL, game.screen, &platform.position);
-    }
+// Only entities overlapping the camera are blitted; the rest of the level
+// costs nothing to draw.
+void draw_objects(float alpha, Uint32 now) {
+    for (int i = 0; i < entities.count; i++) {
+        SDL_Surface* sprite = entities.sprite[i];
+        if (!sprite) continue;
 
-    if (coin.active && coin.sprite) {
-        if (coin.max_frame <= 0) coin.max_frame = 1;
-        int frame_width = coin.sprite->w / coin.max_frame;
-        SDL_Rect src = { coin.frame * frame_width, 0, frame_width, coin.sprite->h };
-        SDL_Rect dest = coin.position;
-        SDL_BlitSurface(coin.sprite, &src, game.screen, &dest);
-    }
+        SDL_Rect dest = entities.type[i] == ENTITY_OBSTACLE
+            ? lerp_rect(entity_prev_rect(i), entity_rect(i), alpha)
+            : entity_rect(i);
+        if (!camera_visible(dest)) continue;
+        dest = camera_to_screen(dest);
 
-    if (obstacle.active && obstacle.sprite) {
-        SDL_BlitSurface(obstacle.sprite, NULL, game.screen, &obstacle.position);
+        if (entities.type[i] == ENTITY_COIN) {
+            int frame_width = sprite->w / entities.max_frame[i];
+            SDL_Rect src = { entities.frame[i] * frame_width, 0, frame_width, sprite->h };
+            SDL_BlitSurface(sprite, &src, game.screen, &dest);
+        } else {
+            SDL_BlitSurface(sprite, NULL, game.screen, &dest);
+        }
+        dirty_mark(dest);
     }
 
-    if (!coin.active && flashBackground) {
-        if (SDL_GetTicks() - flashStartTime < 200) {
-            SDL_Rect glowRect = coin.position;
+    if (flashBackground) {
+        if (now - flashStartTime < 200) {
+            SDL_Rect glowRect = camera_to_screen(flashRect);
             glowRect.x -= 10;
             glowRect.y -= 10;
             glowRect.w += 20;
@@ -168,6 +388,7 @@ void draw_objects() {
                 SDL_FillRect(glow, NULL, SDL_MapRGBA(glow->format, 255, 223, 0, 100));
                 SDL_SetAlpha(glow, SDL_SRCALPHA, 100);
                 SDL_BlitSurface(glow, NULL, game.screen, &glowRect);
+                dirty_mark(glowRect);
                 SDL_FreeSurface(glow);
             }
         } else {
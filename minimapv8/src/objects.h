@@ -2,29 +2,74 @@
 #define OBJECTS_H
 
 #include <SDL/SDL.h>
+#include "fixed.h"
 
+#define MAX_ENTITIES          256   // Pool capacity across all types
+#define MAX_SPAWNS_PER_LEVEL  16
+#define MAX_NEARBY            64    // Candidates returned by one broad-phase query
+#define WORLD_CELL_SHIFT      6     // 64 px broad-phase cells
+#define OBSTACLE_SPEED        INT_TO_FIX(2)
+
+typedef enum {
+    ENTITY_PLATFORM,
+    ENTITY_COIN,
+    ENTITY_OBSTACLE,
+    ENTITY_TRIGGER,     // Invisible area the player activates with E
+    ENTITY_TYPE_COUNT
+} EntityType;
+
+// Slot index in the low 16 bits, slot generation in the high 16 bits, so a
+// handle to a destroyed entity never resolves to whatever reuses its slot.
+typedef Uint32 EntityHandle;
+#define INVALID_ENTITY 0xFFFFFFFFu
+
+// Live entities, structure-of-arrays. Index i is the i-th live entity;
+// indices are packed (0..count-1) and change when an entity is destroyed,
+// so hold on to EntityHandles, not indices, across ticks. Geometry and
+// motion are 16.16 fixed point; entity_rect() gives whole pixels.
 typedef struct {
-    SDL_Surface* sprite;      // The sprite for the object
-    SDL_Rect position;        // Position of the object
-    int active;               // Whether the object is active or not
-
-    // Animation-related variables (added here)
-    int frame;                // Current frame of animation
-    int max_frame;            // Maximum number of frames for the animation
-    int velocityX;            // Horizontal velocity of the object
-    int leftLimit;            // Left limit for obstacle movement
-    int rightLimit;           // Right limit for obstacle movement
-} GameObject;
-
-// Declare external objects
-extern GameObject platform;
-extern GameObject coin;
-extern GameObject obstacle;
+    int          count;
+    fixed_t      x[MAX_ENTITIES];
+    fixed_t      y[MAX_ENTITIES];
+    fixed_t      w[MAX_ENTITIES];
+    fixed_t      h[MAX_ENTITIES];
+    fixed_t      prev_x[MAX_ENTITIES];      // Position at the start of the tick
+    fixed_t      prev_y[MAX_ENTITIES];
+    fixed_t      velocityX[MAX_ENTITIES];
+    fixed_t      leftLimit[MAX_ENTITIES];   // Patrol range, obstacles only
+    fixed_t      rightLimit[MAX_ENTITIES];
+    Sint32       frame[MAX_ENTITIES];
+    Sint32       max_frame[MAX_ENTITIES];
+    Sint32       type[MAX_ENTITIES];
+    Sint32       spawn_id[MAX_ENTITIES];    // Index in the level's spawn table
+    Sint32       target[MAX_ENTITIES];      // Level a trigger leads to
+    const char*  prompt[MAX_ENTITIES];      // Text shown while inside a trigger
+    SDL_Surface* sprite[MAX_ENTITIES];
+    Uint16       slot[MAX_ENTITIES];        // Handle slot owning index i
+} EntityStore;
+
+extern EntityStore entities;
 
 void init_objects();
-void update_objects();
-void draw_objects();
+void update_objects(Uint32 now);
+void draw_objects(float alpha, Uint32 now);
+void snapshot_objects();
 int check_collision(SDL_Rect a, SDL_Rect b);
+int objects_near(SDL_Rect r, int* out, int max_out);
+int find_trigger(SDL_Rect r);
 
-#endif // OBJECTS_H
+EntityHandle entity_create(int type);
+void entity_destroy(EntityHandle h);
+int  entity_index(EntityHandle h);
+EntityHandle entity_handle(int i);
+void entity_clear();
+SDL_Rect entity_rect(int i);
+SDL_Rect entity_prev_rect(int i);
+FixRect  entity_body(int i);
+
+// Batch kernels over parallel arrays of n entities
+void patrol_entities(fixed_t* x, fixed_t* velocityX, const fixed_t* w, const fixed_t* leftLimit,
+                     const fixed_t* rightLimit, int n);
+void animate_entities(Sint32* frame, const Sint32* max_frame, int n);
 
+#endif // OBJECTS_H
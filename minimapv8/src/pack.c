@@ -0,0 +1,187 @@
+#include "pack.h"
+#include "game.h"
+#include <SDL/SDL_image.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static Uint8*     pack_data  = NULL;
+static size_t     pack_size  = 0;
+static PackEntry* pack_index = NULL;
+static Uint32     pack_count = 0;
+
+// Maps the archive if there is one. Returns 0 when it is missing or
+// unusable; every loader then falls back to decoding the loose files.
+int init_pack(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(PackHeader)) {
+        close(fd);
+        return 0;
+    }
+    // Private writable mapping: SDL may rewrite pixels in place when it
+    // undoes RLE on a locked surface, and that must not reach the file.
+    void* data = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return 0;
+
+    PackHeader* header = (PackHeader*)data;
+    size_t index_end = sizeof(PackHeader) + (size_t)header->count * sizeof(PackEntry);
+    if (memcmp(header->magic, PACK_MAGIC, 4) != 0 || header->version != PACK_VERSION ||
+        header->byte_order != 0x01020304 || index_end > (size_t)st.st_size) {
+        fprintf(stderr, "Ignoring %s: not a compatible asset archive\n", path);
+        munmap(data, st.st_size);
+        return 0;
+    }
+
+    pack_data  = data;
+    pack_size  = st.st_size;
+    pack_index = (PackEntry*)(pack_data + sizeof(PackHeader));
+    pack_count = header->count;
+    printf("Mapped %s: %u assets\n", path, (unsigned)pack_count);
+    return 1;
+}
+
+void cleanup_pack() {
+    if (pack_data) munmap(pack_data, pack_size);
+    pack_data = NULL;
+    pack_index = NULL;
+    pack_count = 0;
+}
+
+static PackEntry* find_entry(const char* name) {
+    for (Uint32 i = 0; i < pack_count; i++) {
+        if (strncmp(pack_index[i].name, name, PACK_NAME_LEN) == 0) {
+            PackEntry* e = &pack_index[i];
+            if ((size_t)e->offset + (size_t)e->pitch * e->height > pack_size) return NULL;
+            return e;
+        }
+    }
+    return NULL;
+}
+
+// Builds a surface for a packed asset in the display pixel format. When the
+// display matches the packed layout the surface points into the mapping and
+// nothing is copied; otherwise it is converted. NULL if the asset isn't in
+// the archive.
+SDL_Surface* pack_display_surface(const char* name, SDL_PixelFormat* display) {
+    SDL_Surface* s = pack_surface(name);
+    if (!s) return NULL;
+    if (s->format->Amask)
+        return s;   // Same as SDL_DisplayFormatAlpha output on 32-bit displays
+
+    if (display->BitsPerPixel == 32 && display->Rmask == PACK_RMASK &&
+        display->Gmask == PACK_GMASK && display->Bmask == PACK_BMASK) {
+        return s;
+    }
+    SDL_Surface* converted = SDL_ConvertSurface(s, display, SDL_SWSURFACE);
+    SDL_FreeSurface(s);
+    return converted;
+}
+
+// A packed image as stored, pointing into the mapping. Large sources that
+// are only ever blitted from in pieces use this, so no conversion touches
+// pixels that are never drawn.
+SDL_Surface* pack_surface(const char* name) {
+    PackEntry* e = find_entry(name);
+    if (!e || (e->flags & PACK_TILEMAP)) return NULL;
+
+    int alpha = e->flags & PACK_ALPHA;
+    SDL_Surface* s = SDL_CreateRGBSurfaceFrom(pack_data + e->offset, e->width, e->height, 32,
+                                              e->pitch, PACK_RMASK, PACK_GMASK, PACK_BMASK,
+                                              alpha ? PACK_AMASK : 0);
+    if (s && alpha) SDL_SetAlpha(s, SDL_SRCALPHA, SDL_ALPHA_OPAQUE);
+    return s;
+}
+
+// A level's tile index grid, read in place from the mapping. pitch is in
+// cells. NULL if the archive has no such grid.
+const Uint16* pack_tilemap(const char* name, int* cols, int* rows, int* pitch) {
+    PackEntry* e = find_entry(name);
+    if (!e || !(e->flags & PACK_TILEMAP)) return NULL;
+    *cols = (int)e->width;
+    *rows = (int)e->height;
+    *pitch = (int)(e->pitch / sizeof(Uint16));
+    return (const Uint16*)(pack_data + e->offset);
+}
+
+// Content hash the packer stored for an entry; 0 if it is missing or the
+// archive predates hashes.
+Uint32 pack_hash(const char* name) {
+    PackEntry* e = find_entry(name);
+    return e ? e->hash : 0;
+}
+
+// Pixel size of an image without decoding it, from its pack entry or else
+// the PNG header. Returns 0 if neither is available.
+int image_size(const char* path, int* w, int* h) {
+    PackEntry* e = find_entry(path);
+    if (e) {
+        *w = (int)e->width;
+        *h = (int)e->height;
+        return 1;
+    }
+
+    // 8-byte signature, then the IHDR chunk: length, type, width, height
+    Uint8 head[24];
+    FILE* f = fopen(path, "rb");
+    if (!f) return 0;
+    size_t got = fread(head, 1, sizeof(head), f);
+    fclose(f);
+    if (got != sizeof(head) || memcmp(head, "\x89PNG", 4) != 0 || memcmp(head + 12, "IHDR", 4) != 0)
+        return 0;
+    *w = (head[16] << 24) | (head[17] << 16) | (head[18] << 8) | head[19];
+    *h = (head[20] << 24) | (head[21] << 16) | (head[22] << 8) | head[23];
+    return 1;
+}
+
+// IMG_Load + SDL_DisplayFormat, served from the archive when possible.
+SDL_Surface* load_image(const char* path) {
+    SDL_Surface* s = pack_display_surface(path, game.screen->format);
+    if (s) return s;
+
+    SDL_Surface* temp = IMG_Load(path);
+    if (!temp) {
+        fprintf(stderr, "Failed to load %s: %s\n", path, IMG_GetError());
+        cleanup_game();
+        exit(1);
+    }
+    s = SDL_DisplayFormat(temp);
+    SDL_FreeSurface(temp);
+    if (!s) {
+        fprintf(stderr, "Failed to convert %s\n", path);
+        cleanup_game();
+        exit(1);
+    }
+    return s;
+}
+
+// For images whose key colour becomes transparent: IMG_Load, colorkey,
+// SDL_DisplayFormatAlpha. The packer applies the key when it writes the
+// archive.
+SDL_Surface* load_image_keyed_alpha(const char* path, Uint8 r, Uint8 g, Uint8 b) {
+    SDL_Surface* s = pack_display_surface(path, game.screen->format);
+    if (s) return s;
+
+    SDL_Surface* temp = IMG_Load(path);
+    if (!temp) {
+        fprintf(stderr, "Failed to load %s: %s\n", path, IMG_GetError());
+        cleanup_game();
+        exit(1);
+    }
+    SDL_SetColorKey(temp, SDL_SRCCOLORKEY, SDL_MapRGB(temp->format, r, g, b));
+    s = SDL_DisplayFormatAlpha(temp);
+    SDL_FreeSurface(temp);
+    if (!s) {
+        fprintf(stderr, "Failed to convert %s\n", path);
+        cleanup_game();
+        exit(1);
+    }
+    return s;
+}
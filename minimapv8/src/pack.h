@@ -0,0 +1,57 @@
+#ifndef PACK_H
+#define PACK_H
+
+#include <SDL/SDL.h>
+
+// Asset archive written by tools/packer.c. Pixels are stored already decoded
+// as 32-bit XRGB/ARGB rows, each image and each row starting on a 16-byte
+// boundary, so the game can point surfaces straight at the mapped file.
+#define PACK_PATH      "assets/assets.pak"
+#define PACK_MAGIC     "MMPK"
+#define PACK_VERSION   2
+#define PACK_ALIGN     16
+#define PACK_NAME_LEN  40
+#define PACK_TILESET_NAME "tileset"   // Every distinct level tile, TILESET_COLS per row
+#define PACK_MAP_NAME     "map%d"      // Tile index grid of a level, 1-based
+
+// Levels are stored as a shared tileset plus one grid of Uint16 tile
+// indices per level, covering WORLD_WIDTH x SCREEN_HEIGHT
+#define TILE_SIZE      40    // Divides both screen dimensions
+#define TILESET_COLS   50
+
+#define PACK_ALPHA     0x1   // Entry has a real alpha channel (ARGB)
+#define PACK_TILEMAP   0x2   // Entry is a grid of Uint16 tile indices, not pixels
+
+#define PACK_RMASK     0x00FF0000
+#define PACK_GMASK     0x0000FF00
+#define PACK_BMASK     0x000000FF
+#define PACK_AMASK     0xFF000000
+
+typedef struct {
+    char   magic[4];
+    Uint32 version;
+    Uint32 count;          // Number of PackEntry records after the header
+    Uint32 byte_order;     // 0x01020304 as written by the packer
+} PackHeader;
+
+typedef struct {
+    char   name[PACK_NAME_LEN];   // Asset path, e.g. "assets/coin.png"
+    Uint32 width;
+    Uint32 height;
+    Uint32 pitch;
+    Uint32 flags;
+    Uint32 offset;                // From the start of the file
+    Uint32 hash;                  // FNV-1a of the pixels the entry stands for, 0 if unknown
+} PackEntry;
+
+int  init_pack(const char* path);
+void cleanup_pack();
+SDL_Surface* pack_display_surface(const char* name, SDL_PixelFormat* display);
+SDL_Surface* pack_surface(const char* name);
+const Uint16* pack_tilemap(const char* name, int* cols, int* rows, int* pitch);
+Uint32 pack_hash(const char* name);
+int  image_size(const char* path, int* w, int* h);
+SDL_Surface* load_image(const char* path);
+SDL_Surface* load_image_keyed_alpha(const char* path, Uint8 r, Uint8 g, Uint8 b);
+
+#endif
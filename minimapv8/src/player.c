@@ -1,11 +1,18 @@
 #include "player.h"
 #include "game.h"
 #include "objects.h"
+#include "dirty.h"
+#include "checkpoint.h"
+#include "sprite.h"
+#include "collision.h"
+#include "clock.h"
+#include "camera.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 static void update_src_rect(Player* player, int row, int frame_index) {
+    if (!player->sprite) return;   // Headless, nothing to animate
     int total_frames_per_row = (row == 0) ? player->walk_max_frame : player->jump_max_frame;
     if (total_frames_per_row <= 0) total_frames_per_row = 1;
     
@@ -20,194 +27,176 @@ static void update_src_rect(Player* player, int row, int frame_index) {
     player->srcRect.h = frame_height;
 }
 
-static SDL_Surface* flipSurfaceHorizontal(SDL_Surface* src) {
-    if (!src) return NULL;
-
-    SDL_Surface* flipped = SDL_CreateRGBSurface(src->flags, src->w, src->h, 
-                        src->format->BitsPerPixel, src->format->Rmask,
-                        src->format->Gmask, src->format->Bmask, src->format->Amask);
-    if (!flipped) return NULL;
-
-    SDL_LockSurface(src);
-    SDL_LockSurface(flipped);
-    
-    int pitch = src->pitch;
-    for (int y = 0; y < src->h; ++y) {
-        Uint8* srcRow = (Uint8*)src->pixels + y * pitch;
-        Uint8* flippedRow = (Uint8*)flipped->pixels + y * pitch;
-        for (int x = 0; x < src->w; ++x) {
-            memcpy(&flippedRow[(src->w - 1 - x) * src->format->BytesPerPixel],
-                   &srcRow[x * src->format->BytesPerPixel],
-                   src->format->BytesPerPixel);
-        }
-    }
-    
-    SDL_UnlockSurface(src);
-    SDL_UnlockSurface(flipped);
-    return flipped;
-}
-
 void init_player(Player* player, SDL_Surface* spriteSheet) {
+    init_player_size(player, spriteSheet->w, spriteSheet->h);
     player->sprite = spriteSheet;
-    player->leftSprite = flipSurfaceHorizontal(spriteSheet);
-    if (player->leftSprite) {
-        SDL_SetColorKey(player->leftSprite, SDL_SRCCOLORKEY | SDL_RLEACCEL,
-                        SDL_MapRGB(player->leftSprite->format, 255, 255, 255));
-    }
+    // Both rows have the same frame count, so cells line up across the sheet
+    player->leftSprite = sprite_mirrored(spriteSheet, spriteSheet->w / player->walk_max_frame);
+    update_src_rect(player, 0, 0);
+}
 
+// Sets up everything but the sprites from the sheet size alone, so
+// headless runs get the same collision box without decoding the image
+void init_player_size(Player* player, int sheet_w, int sheet_h) {
+    player->sprite = NULL;
+    player->leftSprite = NULL;
     player->walk_max_frame = 4;
     player->jump_max_frame = 4;
+
     player->frame = 0;
-    player->frameTimer = SDL_GetTicks();
+    player->frameTimer = clock_now();
 
-    int frame_width = player->sprite->w / player->walk_max_frame;
-    int frame_height = player->sprite->h / 2;
+    int frame_width = sheet_w / player->walk_max_frame;
+    int frame_height = sheet_h / 2;
     player->srcRect.w = frame_width;
     player->srcRect.h = frame_height;
 
-    player->position.x = 100;
-    player->position.y = GROUND_LEVEL - frame_height - 10;
-    player->position.w = frame_width;
-    player->position.h = frame_height;
+    player->body.w = INT_TO_FIX(frame_width);
+    player->body.h = INT_TO_FIX(frame_height);
+    place_player(player, INT_TO_FIX(100), INT_TO_FIX(GROUND_LEVEL - frame_height - 10));
+    player->prev_position = player->position;
 
+    player->velocityX = 0;
     player->velocityY = 0;
     player->jumping = 0;
     player->moving = 0;
     player->state = IDLE;
     player->facing_right = 1;
-    update_src_rect(player, 0, 0);
 }
 
-void handle_input_player(Player* player, const Uint8* keystate) {
+void handle_input_player(Player* player, InputState input) {
     int isMoving = 0;
-    if (keystate[SDLK_LEFT]) {
-        player->position.x -= PLAYER_SPEED;
+    player->velocityX = 0;
+    if (input & INPUT_LEFT) {
+        player->velocityX -= PLAYER_SPEED;
         isMoving = 1;
         player->facing_right = 0;
     }
-    if (keystate[SDLK_RIGHT]) {
-        player->position.x += PLAYER_SPEED;
+    if (input & INPUT_RIGHT) {
+        player->velocityX += PLAYER_SPEED;
         isMoving = 1;
         player->facing_right = 1;
     }
     player->moving = isMoving;
 
-    if (keystate[SDLK_UP] && !player->jumping) {
-        player->velocityY = -25;
+    if ((input & INPUT_JUMP) && !player->jumping) {
+        player->velocityY = JUMP_VELOCITY;
         player->jumping = 1;
     }
 }
 
-void update_player(Player* player) {
-    int prev_x = player->position.x;
-    int prev_y = player->position.y;
+// Platforms and obstacles the player could reach moving by (dx, dy).
+// owner[k] is the entity index behind solids[k].
+static int gather_solids(FixRect from, fixed_t dx, fixed_t dy, FixRect* solids, int* owner) {
+    FixRect reach = from;
+    if (dx < 0) reach.x += dx;
+    if (dy < 0) reach.y += dy;
+    reach.w += abs(dx) + FIX_ONE;   // Cover the pixel a fraction reaches into
+    reach.h += abs(dy) + FIX_ONE;
+
+    int near[MAX_NEARBY];
+    int n = objects_near(fix_to_rect(reach), near, MAX_NEARBY), count = 0;
+    for (int k = 0; k < n; k++) {
+        int i = near[k];
+        if (entities.type[i] != ENTITY_PLATFORM && entities.type[i] != ENTITY_OBSTACLE) continue;
+        solids[count] = entity_body(i);
+        owner[count++] = i;
+    }
+    return count;
+}
+
+// Rebuilds the pixel rect everything outside the physics reads
+static void sync_position(Player* player) {
+    player->position = fix_to_rect(player->body);
+}
+
+void place_player(Player* player, fixed_t x, fixed_t y) {
+    player->body.x = x;
+    player->body.y = y;
+    sync_position(player);
+}
 
+void update_player(Player* player, Uint32 now) {
+    FixRect* body = &player->body;
     player->velocityY += GRAVITY;
     if (player->velocityY > MAX_FALL_SPEED)
         player->velocityY = MAX_FALL_SPEED;
-    player->position.y += player->velocityY;
-
-    if (platform.active && check_collision(player->position, platform.position)) {
-        int overlapLeft = (player->position.x + player->position.w) - platform.position.x;
-        int overlapRight = (platform.position.x + platform.position.w) - player->position.x;
-        int overlapTop = (player->position.y + player->position.h) - platform.position.y;
-        int overlapBottom = (platform.position.y + platform.position.h) - player->position.y;
-
-        int xOverlap = (overlapLeft < overlapRight) ? overlapLeft : overlapRight;
-        int yOverlap = (overlapTop < overlapBottom) ? overlapTop : overlapBottom;
 
-        if (xOverlap < yOverlap) {
-            if (overlapLeft < overlapRight) {
-                player->position.x = platform.position.x - player->position.w;
-                if (player->moving && player->facing_right) {
-                    player->position.x -= 20;
-                }
-            } else {
-                player->position.x = platform.position.x + platform.position.w;
-                if (player->moving && !player->facing_right) {
-                    player->position.x += 20;
-                }
-            }
-            if (game.health > 0) game.health -= 5;
-        } else {
-            if (overlapTop < overlapBottom) {
-                player->position.y = platform.position.y - player->position.h;
-                player->velocityY = 0;
-                player->jumping = 0;
+    FixRect solids[MAX_NEARBY];
+    int owner[MAX_NEARBY];
+    Contact contacts[MAX_CONTACTS];
+    int n = gather_solids(*body, player->velocityX, player->velocityY, solids, owner);
+    int hits = resolve_motion(body, player->velocityX, player->velocityY,
+                              solids, n, contacts, MAX_CONTACTS);
+
+    // Platforms hurt on any contact; obstacles only block, and carry a
+    // player standing on them
+    fixed_t push = 0;
+    for (int c = 0; c < hits; c++) {
+        int i = owner[contacts[c].solid];
+        int hurts = entities.type[i] == ENTITY_PLATFORM;
+        if (contacts[c].normal_x) {
+            int into = contacts[c].normal_x < 0 ? player->facing_right : !player->facing_right;
+            if (player->moving && into) push = contacts[c].normal_x * SIDE_KNOCKBACK;
+            if (hurts && game.health > 0) game.health -= 5;
+        } else if (contacts[c].normal_y < 0) {
+            player->velocityY = 0;
+            player->jumping = 0;
+            if (hurts) {
                 if (game.health > 0) game.health -= 5;
             } else {
-                player->position.y = platform.position.y + platform.position.h;
-                player->velocityY = 0;
+                push += entities.velocityX[i];
             }
+        } else {
+            player->velocityY = 0;
         }
     }
+    if (push) {
+        n = gather_solids(*body, push, 0, solids, owner);
+        resolve_motion(body, push, 0, solids, n, NULL, 0);
+    }
+    sync_position(player);
 
     if (game.health <= 0) {
         game.health = MAX_HEALTH;
-        load_game();
+        if (!checkpoint_restore()) load_game();
         return;
     }
 
-    if (obstacle.active && check_collision(player->position, obstacle.position)) {
-        int overlapLeft = (player->position.x + player->position.w) - obstacle.position.x;
-        int overlapRight = (obstacle.position.x + obstacle.position.w) - player->position.x;
-        int overlapTop = (player->position.y + player->position.h) - obstacle.position.y;
-        int overlapBottom = (obstacle.position.y + obstacle.position.h) - player->position.y;
-
-        int xOverlap = (overlapLeft < overlapRight) ? overlapLeft : overlapRight;
-        int yOverlap = (overlapTop < overlapBottom) ? overlapTop : overlapBottom;
-
-        if (xOverlap < yOverlap) {
-            if (overlapLeft < overlapRight) {
-                player->position.x = obstacle.position.x - player->position.w;
-                if (player->moving && player->facing_right) {
-                    player->position.x -= 20;
-                }
-            } else {
-                player->position.x = obstacle.position.x + obstacle.position.w;
-                if (player->moving && !player->facing_right) {
-                    player->position.x += 20;
-                }
-            }
-        } else {
-            if (overlapTop < overlapBottom) {
-                player->position.y = obstacle.position.y - player->position.h;
-                player->velocityY = 0;
-                player->jumping = 0;
-                player->position.x += obstacle.velocityX;
-            } else {
-                player->position.y = obstacle.position.y + obstacle.position.h;
-                player->velocityY = 0;
-            }
-        }
-    }
-
-    if (player->position.y + player->position.h >= GROUND_LEVEL) {
-        player->position.y = GROUND_LEVEL - player->position.h;
+    const fixed_t ground = INT_TO_FIX(GROUND_LEVEL);
+    const fixed_t right_edge = INT_TO_FIX(WORLD_WIDTH);
+    if (body->y + body->h >= ground) {
+        body->y = ground - body->h;
         player->velocityY = 0;
         player->jumping = 0;
     }
 
-    // Modified level transition logic
-    if (player->position.x + player->position.w > SCREEN_WIDTH) {
+    // Level transitions happen at the ends of the world, not the screen
+    if (body->x + body->w > right_edge) {
         if(current_level == 2) { // Block right edge in City 3
-            player->position.x = SCREEN_WIDTH - player->position.w;
+            body->x = right_edge - body->w;
         }
         else if(current_level < MAX_LEVELS-1) {
             load_level(current_level + 1);
-            player->position.x = 0;
+            body->x = 0;
+            sync_position(player);
+            player->prev_position = player->position;
         } else {
-            player->position.x = SCREEN_WIDTH - player->position.w;
+            body->x = right_edge - body->w;
         }
     } 
-    else if (player->position.x < 0) {
+    else if (body->x < 0) {
         if(current_level == 3) { // City4 subway exit
             // Block auto-transition, require E key
-            player->position.x = 0;
+            body->x = 0;
         }
         else if(current_level > 0) {
             load_level(current_level - 1);
-            player->position.x = SCREEN_WIDTH - player->position.w;
+            body->x = right_edge - body->w;
+            sync_position(player);
+            player->prev_position = player->position;
+        } else {
+            body->x = 0;   // Start of the world; the camera can't follow past it
         }
     }
 
@@ -219,7 +208,6 @@ void update_player(Player* player) {
         player->state = IDLE;
     }
 
-    Uint32 now = SDL_GetTicks();
     if (player->state == WALK) {
         if (now - player->frameTimer > 190) {
             player->frame = (player->frame + 1) % player->walk_max_frame;
@@ -237,22 +225,28 @@ void update_player(Player* player) {
         update_src_rect(player, 0, 0);
     }
 
-    if(player->position.y < 0) {
-        player->position.y = 0;
+    if(body->y < 0) {
+        body->y = 0;
         player->velocityY = 0;
     }
-    if(player->position.y + player->position.h > SCREEN_HEIGHT) {
-        player->position.y = SCREEN_HEIGHT - player->position.h;
+    if(body->y + body->h > INT_TO_FIX(SCREEN_HEIGHT)) {
+        body->y = INT_TO_FIX(SCREEN_HEIGHT) - body->h;
         player->velocityY = 0;
     }
+    sync_position(player);
 }
 
-void draw_player(Player* player, SDL_Surface* screen) {
+void draw_player(Player* player, SDL_Surface* screen, float alpha) {
     SDL_Surface* currentSprite = player->facing_right ? player->sprite : player->leftSprite;
-    SDL_BlitSurface(currentSprite, &player->srcRect, screen, &player->position);
+    if (!currentSprite) currentSprite = player->sprite;   // No mirrored sheet: face right
+    SDL_Rect dst = lerp_rect(player->prev_position, player->position, alpha);
+    if (!camera_visible(dst)) return;
+    dst = camera_to_screen(dst);
+    SDL_BlitSurface(currentSprite, &player->srcRect, screen, &dst);
+    dirty_mark(dst);
 }
 
 void cleanup_player(Player* player) {
     if (player->sprite) SDL_FreeSurface(player->sprite);
-    if (player->leftSprite) SDL_FreeSurface(player->leftSprite);
+    player->leftSprite = NULL;   // Owned by the sprite variant cache
 }
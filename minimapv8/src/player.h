@@ -3,11 +3,17 @@
 
 #include <SDL/SDL.h>
 #include <SDL/SDL_image.h>
+#include "fixed.h"
+#include "input.h"
 
-// Movement and physics constants
-#define PLAYER_SPEED 5
-#define GRAVITY 1
-#define MAX_FALL_SPEED 25  // Maximum downward speed
+#define PLAYER_SHEET "assets/player.png"
+
+// Movement and physics constants, 16.16 pixels per tick
+#define PLAYER_SPEED   INT_TO_FIX(5)
+#define GRAVITY        INT_TO_FIX(1)
+#define JUMP_VELOCITY  INT_TO_FIX(-25)
+#define MAX_FALL_SPEED INT_TO_FIX(25)  // Maximum downward speed
+#define SIDE_KNOCKBACK INT_TO_FIX(20)  // Bounce off a solid walked into
 
 // Define player animation states
 typedef enum {
@@ -20,10 +26,12 @@ typedef struct Player {
     SDL_Surface* sprite;        // Normal sprite
     SDL_Surface* leftSprite;    // Left-facing sprite
     SDL_Rect srcRect;           // Rectangle for the animation frame
-    SDL_Rect position;          // Position of the player
+    FixRect body;               // Physics position and size, 16.16
+    SDL_Rect position;          // body in whole pixels, for drawing and lookups
+    SDL_Rect prev_position;     // Position at the start of the current tick
 
-    int velocityX;              // Horizontal velocity
-    int velocityY;              // Vertical velocity
+    fixed_t velocityX;          // Horizontal velocity, 16.16
+    fixed_t velocityY;          // Vertical velocity, 16.16
     int state;                  // State of the player (idle, walking, jumping)
     int jumping;                // Jumping flag
     int moving;                 // Moving flag
@@ -38,9 +46,11 @@ typedef struct Player {
 } Player;
 
 void init_player(Player* player, SDL_Surface* spriteSheet);
-void handle_input_player(Player* player, const Uint8* keystate);
-void update_player(Player* player);
-void draw_player(Player* player, SDL_Surface* screen);
+void init_player_size(Player* player, int sheet_w, int sheet_h);
+void handle_input_player(Player* player, InputState input);
+void update_player(Player* player, Uint32 now);
+void place_player(Player* player, fixed_t x, fixed_t y);
+void draw_player(Player* player, SDL_Surface* screen, float alpha);
 void cleanup_player(Player* player);
 
 #endif
@@ -0,0 +1,119 @@
+#include "present.h"
+#include "dirty.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+static PresentMode mode      = PRESENT_LIMIT;
+static int         fps       = PRESENT_DEFAULT_FPS;
+static Uint64      target_ns = 0;   // 0 when uncapped
+static Uint64      deadline  = 0;
+static Uint64      last_frame = 0;   // 0 until the first frame is out
+
+// Intervals between consecutive frames
+static Uint32 histogram[PACING_BUCKETS];
+static Uint32 intervals = 0;
+static double sum_ms = 0, sum_sq_ms = 0, max_ms = 0;
+
+static const char* mode_names[] = {"vsync", "limit", "uncapped"};
+
+static Uint64 now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (Uint64)ts.tv_sec * 1000000000u + (Uint64)ts.tv_nsec;
+}
+
+void present_configure(PresentMode m, int target_fps) {
+    mode = m;
+    if (target_fps > 0) fps = target_fps;
+}
+
+int present_parse_mode(const char* name, PresentMode* m) {
+    for (int i = 0; i < (int)(sizeof(mode_names) / sizeof(mode_names[0])); i++) {
+        if (strcmp(name, mode_names[i]) == 0) {
+            *m = (PresentMode)i;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+Uint32 present_video_flags() {
+    return mode == PRESENT_VSYNC ? SDL_HWSURFACE | SDL_DOUBLEBUF : SDL_SWSURFACE;
+}
+
+// Checks what SDL_SetVideoMode actually gave us. Without a hardware double
+// buffer there is no vsync to wait on, so pacing falls back to the limiter.
+void init_present(SDL_Surface* screen) {
+    if (mode == PRESENT_VSYNC) {
+        if ((screen->flags & (SDL_HWSURFACE | SDL_DOUBLEBUF)) == (SDL_HWSURFACE | SDL_DOUBLEBUF)) {
+            // SDL_Flip swaps buffers, so the back buffer holds the frame
+            // before last; patching only the dirty rects would show stale
+            // pixels
+            dirty_init(0);
+        } else {
+            printf("No hardware double buffer, limiting to %d fps instead\n", fps);
+            mode = PRESENT_LIMIT;
+        }
+    }
+    target_ns = mode == PRESENT_LIMIT ? 1000000000u / fps : 0;
+    deadline = now_ns();
+    last_frame = 0;
+    printf("Present mode: %s\n", mode_names[mode]);
+}
+
+static void record_interval(Uint64 ns) {
+    double ms = ns / 1e6;
+    Uint32 bucket = (Uint32)(ns / 1000 / PACING_BUCKET_US);
+    if (bucket >= PACING_BUCKETS) bucket = PACING_BUCKETS - 1;
+    histogram[bucket]++;
+    intervals++;
+    sum_ms += ms;
+    sum_sq_ms += ms * ms;
+    if (ms > max_ms) max_ms = ms;
+}
+
+// Called once per frame after presenting. In limit mode it sleeps until
+// the next frame is due; the deadline advances by the target each frame
+// rather than from when we woke, so oversleeping one frame doesn't push
+// every later frame back.
+void present_pace() {
+    if (target_ns) {
+        deadline += target_ns;
+        Uint64 now = now_ns();
+        if (now > deadline + target_ns) {
+            deadline = now;   // More than a frame late; don't try to catch up
+        } else {
+            // SDL_Delay may oversleep by a millisecond or so; sleep short
+            // and spin out the rest
+            if (deadline > now + 2000000)
+                SDL_Delay((Uint32)((deadline - now) / 1000000) - 1);
+            while (now_ns() < deadline) {}
+        }
+    }
+
+    Uint64 now = now_ns();
+    if (last_frame) record_interval(now - last_frame);
+    last_frame = now;
+}
+
+static double interval_percentile(int p) {
+    Uint32 rank = (Uint32)(((Uint64)intervals * p + 99) / 100), seen = 0;
+    for (int b = 0; b < PACING_BUCKETS; b++) {
+        seen += histogram[b];
+        if (seen >= rank && seen > 0) return (b + 1) * PACING_BUCKET_US / 1000.0;
+    }
+    return max_ms;
+}
+
+void present_report() {
+    if (intervals == 0) return;
+    double mean = sum_ms / intervals;
+    double var = sum_sq_ms / intervals - mean * mean;
+    double jitter = var > 0 ? sqrt(var) : 0;
+    printf("Frame pacing (%s", mode_names[mode]);
+    if (target_ns) printf(", target %.2f ms", target_ns / 1e6);
+    printf("): %u frames, mean %.2f ms, jitter %.3f ms stddev, p50 %.2f p99 %.2f max %.2f ms\n",
+           (unsigned)intervals, mean, jitter, interval_percentile(50), interval_percentile(99), max_ms);
+}
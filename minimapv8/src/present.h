@@ -0,0 +1,23 @@
+#ifndef PRESENT_H
+#define PRESENT_H
+
+#include <SDL/SDL.h>
+
+#define PRESENT_DEFAULT_FPS  60
+#define PACING_BUCKET_US     50     // Histogram resolution for the pacing report
+#define PACING_BUCKETS       2000   // 100 ms; longer frames land in the last bucket
+
+typedef enum {
+    PRESENT_VSYNC,      // Hardware double buffer; SDL_Flip waits for the display
+    PRESENT_LIMIT,      // Software surface, sleep to a target frame time
+    PRESENT_UNCAPPED,   // Present as fast as possible, for benchmarking
+} PresentMode;
+
+void   present_configure(PresentMode mode, int fps);
+int    present_parse_mode(const char* name, PresentMode* mode);
+Uint32 present_video_flags();
+void   init_present(SDL_Surface* screen);
+void   present_pace();
+void   present_report();
+
+#endif
@@ -0,0 +1,176 @@
+#include "profile.h"
+#include "dirty.h"
+#include "text.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct {
+    const char* name;
+    Uint64      start_ns;
+    Uint64      frame_ns;                   // Time spent in the current frame
+    float       history[PROFILE_HISTORY];   // ms per frame, ring
+    Uint32      buckets[PROFILE_BUCKETS];   // ms per frame, whole run
+    Uint32      count;
+    double      sum_ms;
+    float       max_ms;
+} Scope;
+
+static Scope scopes[PROF_SCOPE_COUNT] = {
+    {"frame"}, {"input"}, {"player"}, {"objects"}, {"background"},
+    {"draw objects"}, {"draw player"}, {"minimap"}, {"text"}, {"present"},
+};
+static int enabled     = 0;
+static int show_hud    = 0;
+static int history_pos = 0;
+static int history_len = 0;
+
+static Uint64 now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (Uint64)ts.tv_sec * 1000000000u + (Uint64)ts.tv_nsec;
+}
+
+void init_profile() {
+    enabled = 1;
+}
+
+void profile_begin(ProfileScope s) {
+    if (enabled) scopes[s].start_ns = now_ns();
+}
+
+void profile_end(ProfileScope s) {
+    if (enabled) scopes[s].frame_ns += now_ns() - scopes[s].start_ns;
+}
+
+static void add_sample(Scope* sc, float ms) {
+    Uint32 bucket = (Uint32)(ms * 1000.0f / PROFILE_BUCKET_US);
+    if (bucket >= PROFILE_BUCKETS) bucket = PROFILE_BUCKETS - 1;
+    sc->buckets[bucket]++;
+    sc->count++;
+    sc->sum_ms += ms;
+    if (ms > sc->max_ms) sc->max_ms = ms;
+}
+
+void profile_frame() {
+    if (!enabled) return;
+    for (int i = 0; i < PROF_SCOPE_COUNT; i++) {
+        float ms = scopes[i].frame_ns / 1e6f;
+        scopes[i].history[history_pos] = ms;
+        add_sample(&scopes[i], ms);
+        scopes[i].frame_ns = 0;
+    }
+    history_pos = (history_pos + 1) % PROFILE_HISTORY;
+    if (history_len < PROFILE_HISTORY) history_len++;
+}
+
+void profile_toggle_hud() {
+    show_hud = !show_hud;
+    dirty_invalidate();   // Clear the overlay away when it goes off
+}
+
+static int compare_float(const void* a, const void* b) {
+    float x = *(const float*)a, y = *(const float*)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of sorted values
+static float percentile(const float* sorted, size_t n, int p) {
+    if (n == 0) return 0.0f;
+    size_t rank = (n * p + 99) / 100;
+    return sorted[rank ? rank - 1 : 0];
+}
+
+#define GRAPH_X       10
+#define GRAPH_Y       70
+#define GRAPH_HEIGHT  50
+#define GRAPH_PX_PER_MS 2   // 25 ms fills the graph
+#define BUDGET_MS     (1000.0f / 60)   // One refresh at 60 Hz
+
+// Frame-time graph of the history plus one line per scope: mean and
+// worst over the history, and the frame p95
+void draw_profile(SDL_Surface* screen) {
+    if (!enabled || !show_hud) return;
+
+    SDL_Rect graph = {GRAPH_X, GRAPH_Y, PROFILE_HISTORY, GRAPH_HEIGHT};
+    SDL_FillRect(screen, &graph, SDL_MapRGB(screen->format, 0, 0, 0));
+    Uint32 bar = SDL_MapRGB(screen->format, 0, 200, 0);
+    Uint32 over = SDL_MapRGB(screen->format, 220, 0, 0);
+    for (int k = 0; k < history_len; k++) {
+        // Oldest on the left
+        int idx = (history_pos - history_len + k + PROFILE_HISTORY) % PROFILE_HISTORY;
+        float ms = scopes[PROF_FRAME].history[idx];
+        int h = (int)(ms * GRAPH_PX_PER_MS);
+        if (h > GRAPH_HEIGHT) h = GRAPH_HEIGHT;
+        if (h < 1) h = 1;
+        SDL_Rect col = {(Sint16)(GRAPH_X + k), (Sint16)(GRAPH_Y + GRAPH_HEIGHT - h), 1, (Uint16)h};
+        SDL_FillRect(screen, &col, ms > BUDGET_MS ? over : bar);
+    }
+    SDL_Rect budget = {GRAPH_X, (Sint16)(GRAPH_Y + GRAPH_HEIGHT - (int)(BUDGET_MS * GRAPH_PX_PER_MS)),
+                       PROFILE_HISTORY, 1};
+    SDL_FillRect(screen, &budget, SDL_MapRGB(screen->format, 255, 255, 0));
+    dirty_mark(graph);
+
+    float sorted[PROFILE_HISTORY];
+    memcpy(sorted, scopes[PROF_FRAME].history, sizeof(sorted));
+    qsort(sorted, history_len, sizeof(float), compare_float);
+
+    char line[TEXT_MAX_LEN];
+    int y = GRAPH_Y + GRAPH_HEIGHT + 4;
+    snprintf(line, sizeof(line), "frame p50 %.2f p95 %.2f p99 %.2f ms",
+             percentile(sorted, history_len, 50), percentile(sorted, history_len, 95),
+             percentile(sorted, history_len, 99));
+    render_text_dynamic(screen, line, GRAPH_X, y);
+    for (int i = 1; i < PROF_SCOPE_COUNT; i++) {
+        float sum = 0, worst = 0;
+        for (int k = 0; k < history_len; k++) {
+            sum += scopes[i].history[k];
+            if (scopes[i].history[k] > worst) worst = scopes[i].history[k];
+        }
+        y += 18;
+        snprintf(line, sizeof(line), "%-12s %.3f avg %.3f max",
+                 scopes[i].name, history_len ? sum / history_len : 0.0f, worst);
+        render_text_dynamic(screen, line, GRAPH_X, y);
+    }
+}
+
+// Upper edge of the bucket holding the nearest-rank percentile
+static double bucket_percentile(const Scope* sc, int p) {
+    Uint32 rank = (Uint32)(((Uint64)sc->count * p + 99) / 100), seen = 0;
+    for (int b = 0; b < PROFILE_BUCKETS; b++) {
+        seen += sc->buckets[b];
+        if (seen >= rank && seen > 0) return (b + 1) * PROFILE_BUCKET_US / 1000.0;
+    }
+    return sc->max_ms;
+}
+
+static void write_csv(const char* path) {
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "Cannot write %s\n", path);
+        return;
+    }
+    fprintf(f, "scope,frames,mean_ms,p50_ms,p95_ms,p99_ms,max_ms\n");
+    for (int i = 0; i < PROF_SCOPE_COUNT; i++) {
+        Scope* sc = &scopes[i];
+        fprintf(f, "%s,%lu,%.4f,%.4f,%.4f,%.4f,%.4f\n", sc->name, (unsigned long)sc->count,
+                sc->count ? sc->sum_ms / sc->count : 0.0,
+                bucket_percentile(sc, 50), bucket_percentile(sc, 95),
+                bucket_percentile(sc, 99), sc->max_ms);
+    }
+    fclose(f);
+    printf("Wrote frame percentiles to %s\n", path);
+}
+
+void cleanup_profile() {
+    if (!enabled) return;
+    if (scopes[PROF_FRAME].count) write_csv(PROFILE_CSV);
+    for (int i = 0; i < PROF_SCOPE_COUNT; i++) {
+        memset(scopes[i].buckets, 0, sizeof(scopes[i].buckets));
+        scopes[i].count = 0;
+        scopes[i].sum_ms = 0;
+        scopes[i].max_ms = 0;
+    }
+    enabled = 0;
+}
@@ -0,0 +1,35 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <SDL/SDL.h>
+
+#define PROFILE_HISTORY    240            // Frames kept for the overlay
+#define PROFILE_CSV        "profile.csv"  // Percentiles over the whole run, written on exit
+#define PROFILE_BUCKET_US  10             // Histogram resolution for the CSV percentiles
+#define PROFILE_BUCKETS    5000           // 50 ms; longer scopes land in the last bucket
+
+typedef enum {
+    PROF_FRAME,          // Whole main-loop iteration
+    PROF_INPUT,          // Key actions and handle_input_player
+    PROF_PLAYER,         // update_player
+    PROF_OBJECTS,        // update_objects and checkpoints
+    PROF_BACKGROUND,     // Background restore or blit
+    PROF_DRAW_OBJECTS,
+    PROF_DRAW_PLAYER,
+    PROF_MINIMAP,
+    PROF_TEXT,           // HUD text and health bar
+    PROF_PRESENT,        // SDL_Flip / SDL_UpdateRects
+    PROF_SCOPE_COUNT
+} ProfileScope;
+
+// Scoped timers on the monotonic clock. A scope entered several times in
+// one frame (simulation ticks) adds up; profile_frame() closes the frame.
+void init_profile();
+void cleanup_profile();
+void profile_begin(ProfileScope s);
+void profile_end(ProfileScope s);
+void profile_frame();
+void profile_toggle_hud();
+void draw_profile(SDL_Surface* screen);
+
+#endif
@@ -0,0 +1,223 @@
+#include "save.h"
+#include <SDL/SDL_thread.h>
+#include <SDL/SDL_mutex.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef struct {
+    int      used;
+    char     path[SAVE_PATH_LEN];
+    SaveData data;
+} SaveRequest;
+
+static SaveRequest queue[SAVE_QUEUE_SIZE];
+static SaveRequest inflight;   // Being written; still what a load must see
+static SDL_Thread* thread = NULL;
+static SDL_mutex*  lock   = NULL;
+static SDL_cond*   wake   = NULL;
+static int         quit   = 0;
+
+static Uint32 fnv1a(const Uint8* p, size_t n) {
+    Uint32 h = 2166136261u;
+    for (size_t i = 0; i < n; i++) {
+        h ^= p[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static void put32(Uint8* p, Uint32 v) {
+    p[0] = (Uint8)v;
+    p[1] = (Uint8)(v >> 8);
+    p[2] = (Uint8)(v >> 16);
+    p[3] = (Uint8)(v >> 24);
+}
+
+static Uint32 get32(const Uint8* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((Uint32)p[3] << 24);
+}
+
+static void encode(const SaveData* d, Uint8* rec) {
+    Sint32 fields[SAVE_FIELDS] = {d->x, d->y, d->coin_active, d->health, d->score, d->level};
+    memcpy(&fields[6], d->collected_coins, sizeof(d->collected_coins));
+
+    memcpy(rec, SAVE_MAGIC, 4);
+    put32(rec + 4, SAVE_VERSION);
+    put32(rec + 8, SAVE_FIELDS * 4);
+    for (int i = 0; i < SAVE_FIELDS; i++)
+        put32(rec + 12 + i * 4, (Uint32)fields[i]);
+    put32(rec + SAVE_RECORD_SIZE - 4, fnv1a(rec, SAVE_RECORD_SIZE - 4));
+}
+
+static int decode(const Uint8* rec, SaveData* d) {
+    if (memcmp(rec, SAVE_MAGIC, 4) != 0) return 0;
+    if (get32(rec + 4) != SAVE_VERSION || get32(rec + 8) != SAVE_FIELDS * 4) return 0;
+    if (get32(rec + SAVE_RECORD_SIZE - 4) != fnv1a(rec, SAVE_RECORD_SIZE - 4)) return 0;
+
+    Sint32 fields[SAVE_FIELDS];
+    for (int i = 0; i < SAVE_FIELDS; i++)
+        fields[i] = (Sint32)get32(rec + 12 + i * 4);
+    d->x = fields[0];
+    d->y = fields[1];
+    d->coin_active = fields[2];
+    d->health = fields[3];
+    d->score = fields[4];
+    d->level = fields[5];
+    memcpy(d->collected_coins, &fields[6], sizeof(d->collected_coins));
+    return 1;
+}
+
+// Writes next to the target and renames over it, so a crash mid-write
+// leaves the previous save intact.
+static int write_record(const char* path, const SaveData* d) {
+    Uint8 rec[SAVE_RECORD_SIZE];
+    encode(d, rec);
+
+    char tmp_path[SAVE_PATH_LEN + 4];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE* f = fopen(tmp_path, "wb");
+    if (!f) {
+        fprintf(stderr, "Cannot write %s\n", tmp_path);
+        return 0;
+    }
+    int ok = fwrite(rec, sizeof(rec), 1, f) == 1;
+    ok = fflush(f) == 0 && ok;
+    ok = fsync(fileno(f)) == 0 && ok;
+    ok = fclose(f) == 0 && ok;
+    if (!ok || rename(tmp_path, path) != 0) {
+        fprintf(stderr, "Cannot write %s\n", path);
+        remove(tmp_path);
+        return 0;
+    }
+    return 1;
+}
+
+static int save_thread(void* unused) {
+    (void)unused;
+    SDL_LockMutex(lock);
+    for (;;) {
+        int next = -1;
+        for (int i = 0; i < SAVE_QUEUE_SIZE; i++) {
+            if (queue[i].used) {
+                next = i;
+                break;
+            }
+        }
+        if (next < 0) {
+            if (quit) break;   // Only quit once everything queued is on disk
+            SDL_CondWait(wake, lock);
+            continue;
+        }
+
+        inflight = queue[next];
+        queue[next].used = 0;
+        SDL_UnlockMutex(lock);
+        write_record(inflight.path, &inflight.data);
+        SDL_LockMutex(lock);
+        inflight.used = 0;
+    }
+    SDL_UnlockMutex(lock);
+    return 0;
+}
+
+void init_save() {
+    lock = SDL_CreateMutex();
+    wake = SDL_CreateCond();
+    if (lock && wake)
+        thread = SDL_CreateThread(save_thread, NULL);
+    if (!thread)
+        fprintf(stderr, "Save thread unavailable, saving synchronously: %s\n", SDL_GetError());
+}
+
+void cleanup_save() {
+    if (thread) {
+        SDL_LockMutex(lock);
+        quit = 1;
+        SDL_CondSignal(wake);
+        SDL_UnlockMutex(lock);
+        SDL_WaitThread(thread, NULL);
+        thread = NULL;
+    }
+    if (wake) SDL_DestroyCond(wake);
+    if (lock) SDL_DestroyMutex(lock);
+    wake = NULL;
+    lock = NULL;
+}
+
+// Queues a save for the writer thread. A newer save to the same path
+// replaces one that hasn't been written yet.
+void save_write_async(const char* path, const SaveData* data) {
+    if (!thread) {
+        write_record(path, data);
+        return;
+    }
+
+    SDL_LockMutex(lock);
+    int slot = -1;
+    for (int i = 0; i < SAVE_QUEUE_SIZE; i++) {
+        if (queue[i].used && strcmp(queue[i].path, path) == 0) {
+            slot = i;
+            break;
+        }
+        if (!queue[i].used && slot < 0) slot = i;
+    }
+    if (slot < 0) {
+        // Queue full of other paths; write this one here instead of dropping it
+        SDL_UnlockMutex(lock);
+        write_record(path, data);
+        return;
+    }
+    queue[slot].used = 1;
+    snprintf(queue[slot].path, sizeof(queue[slot].path), "%s", path);
+    queue[slot].data = *data;
+    SDL_CondSignal(wake);
+    SDL_UnlockMutex(lock);
+}
+
+// Reads a binary save. A save still queued or being written wins over the
+// file, so loading right after saving sees the new state.
+int save_read(const char* path, SaveData* out) {
+    if (lock) {
+        SDL_LockMutex(lock);
+        for (int i = 0; i < SAVE_QUEUE_SIZE; i++) {
+            if (queue[i].used && strcmp(queue[i].path, path) == 0) {
+                *out = queue[i].data;
+                SDL_UnlockMutex(lock);
+                return 1;
+            }
+        }
+        if (inflight.used && strcmp(inflight.path, path) == 0) {
+            *out = inflight.data;
+            SDL_UnlockMutex(lock);
+            return 1;
+        }
+        SDL_UnlockMutex(lock);
+    }
+
+    FILE* f = fopen(path, "rb");
+    if (!f) return 0;
+    Uint8 rec[SAVE_RECORD_SIZE];
+    int ok = fread(rec, sizeof(rec), 1, f) == 1;
+    fclose(f);
+    if (!ok || !decode(rec, out)) {
+        fprintf(stderr, "Ignoring corrupt or incompatible %s\n", path);
+        return 0;
+    }
+    return 1;
+}
+
+// Reads the old whitespace-separated save.txt format
+int save_read_legacy(const char* path, SaveData* out) {
+    FILE* f = fopen(path, "r");
+    if (!f) return 0;
+    int ok = fscanf(f, "%d %d %d %d %d %d",
+                    &out->x, &out->y, &out->coin_active,
+                    &out->health, &out->score, &out->level) == 6;
+    for (int i = 0; i < MAX_LEVELS; i++) {
+        if (!ok || fscanf(f, " %d", &out->collected_coins[i]) != 1)
+            out->collected_coins[i] = 0;
+    }
+    fclose(f);
+    return ok;
+}
@@ -0,0 +1,34 @@
+#ifndef SAVE_H
+#define SAVE_H
+
+#include <SDL/SDL.h>
+#include "game.h"
+
+#define SAVE_PATH         "save.bin"
+#define LEGACY_SAVE_PATH  "save.txt"
+#define SAVE_MAGIC        "MMSV"
+#define SAVE_VERSION      1
+#define SAVE_QUEUE_SIZE   4
+#define SAVE_PATH_LEN     64
+
+typedef struct {
+    Sint32 x, y;
+    Sint32 coin_active;
+    Sint32 health;
+    Sint32 score;
+    Sint32 level;
+    Sint32 collected_coins[MAX_LEVELS];
+} SaveData;
+
+// On disk: magic, version, payload size, the SaveData fields in order as
+// little-endian 32-bit integers, then an FNV-1a checksum of everything before it.
+#define SAVE_FIELDS       (6 + MAX_LEVELS)
+#define SAVE_RECORD_SIZE  (4 + 4 + 4 + SAVE_FIELDS * 4 + 4)
+
+void init_save();
+void cleanup_save();
+void save_write_async(const char* path, const SaveData* data);
+int  save_read(const char* path, SaveData* out);
+int  save_read_legacy(const char* path, SaveData* out);
+
+#endif
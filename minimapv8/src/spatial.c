@@ -0,0 +1,85 @@
+#include "spatial.h"
+#include <stdlib.h>
+#include <string.h>
+
+static int bucket_of(const SpatialHash* hash, int cx, int cy) {
+    Uint32 h = (Uint32)cx * 73856093u ^ (Uint32)cy * 19349663u;
+    return (int)(h & (Uint32)hash->bucket_mask);
+}
+
+int spatial_init(SpatialHash* hash, int cell_shift, int bucket_count, int max_items, int max_entries) {
+    memset(hash, 0, sizeof(*hash));
+    hash->cell_shift = cell_shift;
+    hash->bucket_mask = bucket_count - 1;
+    hash->entry_capacity = max_entries;
+    hash->max_items = max_items;
+    hash->bucket_head = malloc(bucket_count * sizeof(int));
+    hash->entry_next = malloc(max_entries * sizeof(int));
+    hash->entry_item = malloc(max_entries * sizeof(int));
+    hash->item_stamp = calloc(max_items, sizeof(int));
+    if (!hash->bucket_head || !hash->entry_next || !hash->entry_item || !hash->item_stamp) {
+        spatial_free(hash);
+        return 0;
+    }
+    spatial_clear(hash);
+    return 1;
+}
+
+void spatial_free(SpatialHash* hash) {
+    free(hash->bucket_head);
+    free(hash->entry_next);
+    free(hash->entry_item);
+    free(hash->item_stamp);
+    memset(hash, 0, sizeof(*hash));
+}
+
+void spatial_clear(SpatialHash* hash) {
+    memset(hash->bucket_head, 0xFF, (hash->bucket_mask + 1) * sizeof(int));
+    hash->entry_count = 0;
+}
+
+// Cell range covered by r. The right/bottom edge is inclusive to match
+// check_collision, which treats touching rects as overlapping.
+static void cell_range(const SpatialHash* hash, SDL_Rect r, int* x0, int* y0, int* x1, int* y1) {
+    *x0 = r.x >> hash->cell_shift;
+    *y0 = r.y >> hash->cell_shift;
+    *x1 = (r.x + r.w) >> hash->cell_shift;
+    *y1 = (r.y + r.h) >> hash->cell_shift;
+}
+
+// Returns 0 if the hash ran out of entries; the item is then only partly
+// inserted and the caller should grow max_entries.
+int spatial_insert(SpatialHash* hash, int item, SDL_Rect r) {
+    int x0, y0, x1, y1;
+    cell_range(hash, r, &x0, &y0, &x1, &y1);
+    for (int cy = y0; cy <= y1; cy++) {
+        for (int cx = x0; cx <= x1; cx++) {
+            if (hash->entry_count == hash->entry_capacity) return 0;
+            int e = hash->entry_count++;
+            int b = bucket_of(hash, cx, cy);
+            hash->entry_item[e] = item;
+            hash->entry_next[e] = hash->bucket_head[b];
+            hash->bucket_head[b] = e;
+        }
+    }
+    return 1;
+}
+
+// Writes up to max_out candidate items overlapping r and returns how many
+int spatial_query(SpatialHash* hash, SDL_Rect r, int* out, int max_out) {
+    int x0, y0, x1, y1, n = 0;
+    cell_range(hash, r, &x0, &y0, &x1, &y1);
+    hash->stamp++;
+    for (int cy = y0; cy <= y1; cy++) {
+        for (int cx = x0; cx <= x1; cx++) {
+            for (int e = hash->bucket_head[bucket_of(hash, cx, cy)]; e >= 0; e = hash->entry_next[e]) {
+                int item = hash->entry_item[e];
+                if (hash->item_stamp[item] == hash->stamp) continue;
+                hash->item_stamp[item] = hash->stamp;
+                if (n == max_out) return n;
+                out[n++] = item;
+            }
+        }
+    }
+    return n;
+}
@@ -0,0 +1,30 @@
+#ifndef SPATIAL_H
+#define SPATIAL_H
+
+#include <SDL/SDL.h>
+
+// Uniform-grid spatial hash over world space. Items are small integers
+// (entity indices); a rect is entered in every cell it touches, and a
+// query returns each item whose cells overlap the query rect once. The
+// result is a superset of the true overlaps, so callers still run
+// check_collision on the candidates.
+typedef struct {
+    int  cell_shift;      // Cells are (1 << cell_shift) pixels square
+    int  bucket_mask;     // Bucket count - 1, a power of two
+    int* bucket_head;     // First entry per bucket, -1 if empty
+    int* entry_next;
+    int* entry_item;
+    int  entry_count;
+    int  entry_capacity;
+    int* item_stamp;      // Last query that returned each item
+    int  max_items;
+    int  stamp;
+} SpatialHash;
+
+int  spatial_init(SpatialHash* hash, int cell_shift, int bucket_count, int max_items, int max_entries);
+void spatial_free(SpatialHash* hash);
+void spatial_clear(SpatialHash* hash);
+int  spatial_insert(SpatialHash* hash, int item, SDL_Rect r);
+int  spatial_query(SpatialHash* hash, SDL_Rect r, int* out, int max_out);
+
+#endif
@@ -0,0 +1,271 @@
+#include "sprite.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#define SPRITE_X86 1
+#include <immintrin.h>
+#endif
+
+typedef struct {
+    SDL_Surface* sheet;
+    int          frame_width;
+    SDL_Surface* mirrored;
+} SpriteVariant;
+
+static SpriteVariant variants[SPRITE_VARIANT_CACHE];
+static int           variant_count = 0;
+
+static void reverse_row32_scalar(Uint32* dst, const Uint32* src, int n) {
+    for (int i = 0; i < n; i++)
+        dst[i] = src[n - 1 - i];
+}
+
+#ifdef SPRITE_X86
+static void reverse_row32_sse2(Uint32* dst, const Uint32* src, int n) {
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + n - 4 - i));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3)));
+    }
+    reverse_row32_scalar(dst + i, src, n - i);   // Leftover pixels are the start of src
+}
+
+__attribute__((target("avx2")))
+static void reverse_row32_avx2(Uint32* dst, const Uint32* src, int n) {
+    const __m256i reverse = _mm256_set_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(src + n - 8 - i));
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_permutevar8x32_epi32(v, reverse));
+    }
+    reverse_row32_scalar(dst + i, src, n - i);   // Leftover pixels are the start of src
+}
+#endif
+
+typedef void (*ReverseRow32)(Uint32*, const Uint32*, int);
+
+static ReverseRow32 pick_kernel() {
+#ifdef SPRITE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return reverse_row32_avx2;
+    return reverse_row32_sse2;
+#else
+    return reverse_row32_scalar;
+#endif
+}
+
+// Any other depth: reverse whole pixels byte by byte
+static void reverse_row_generic(Uint8* dst, const Uint8* src, int n, int bpp) {
+    for (int i = 0; i < n; i++) {
+        const Uint8* s = src + (n - 1 - i) * bpp;
+        for (int b = 0; b < bpp; b++)
+            dst[i * bpp + b] = s[b];
+    }
+}
+
+// Mirrors each frame_width-wide cell of the sheet in place, so frame k of
+// the result is frame k of the source facing the other way.
+static SDL_Surface* mirror_cells(SDL_Surface* src, int frame_width) {
+    SDL_PixelFormat* fmt = src->format;
+    SDL_Surface* dst = SDL_CreateRGBSurface(SDL_SWSURFACE, src->w, src->h, fmt->BitsPerPixel,
+                                            fmt->Rmask, fmt->Gmask, fmt->Bmask, fmt->Amask);
+    if (!dst) return NULL;
+    if (fmt->palette)
+        SDL_SetColors(dst, fmt->palette->colors, 0, fmt->palette->ncolors);
+
+    int bpp = fmt->BytesPerPixel;
+    ReverseRow32 reverse32 = (bpp == 4) ? pick_kernel() : NULL;
+
+    SDL_LockSurface(src);
+    SDL_LockSurface(dst);
+    for (int y = 0; y < src->h; y++) {
+        const Uint8* srow = (const Uint8*)src->pixels + y * src->pitch;
+        Uint8* drow = (Uint8*)dst->pixels + y * dst->pitch;
+        for (int x = 0; x < src->w; x += frame_width) {
+            int n = (x + frame_width <= src->w) ? frame_width : src->w - x;
+            if (reverse32)
+                reverse32((Uint32*)(drow + x * 4), (const Uint32*)(srow + x * 4), n);
+            else
+                reverse_row_generic(drow + x * bpp, srow + x * bpp, n, bpp);
+        }
+    }
+    SDL_UnlockSurface(dst);
+    SDL_UnlockSurface(src);
+
+    if (src->flags & SDL_SRCCOLORKEY)
+        SDL_SetColorKey(dst, src->flags & (SDL_SRCCOLORKEY | SDL_RLEACCEL), fmt->colorkey);
+    if (src->flags & SDL_SRCALPHA)
+        SDL_SetAlpha(dst, src->flags & (SDL_SRCALPHA | SDL_RLEACCEL), fmt->alpha);
+    return dst;
+}
+
+// Returns the left-facing variant of a sprite sheet, building it the first
+// time it is asked for. Pass the sheet width as frame_width to mirror the
+// sheet as a whole. The cache owns the result; free it with cleanup_sprites.
+// NULL if it can't be built or the cache is full.
+SDL_Surface* sprite_mirrored(SDL_Surface* sheet, int frame_width) {
+    if (!sheet) return NULL;
+    if (frame_width <= 0 || frame_width > sheet->w) frame_width = sheet->w;
+
+    for (int i = 0; i < variant_count; i++) {
+        if (variants[i].sheet == sheet && variants[i].frame_width == frame_width)
+            return variants[i].mirrored;
+    }
+
+    if (variant_count == SPRITE_VARIANT_CACHE) {
+        fprintf(stderr, "Sprite variant cache full, raise SPRITE_VARIANT_CACHE\n");
+        return NULL;
+    }
+    SDL_Surface* mirrored = mirror_cells(sheet, frame_width);
+    if (!mirrored) {
+        fprintf(stderr, "Failed to mirror sprite sheet: %s\n", SDL_GetError());
+        return NULL;
+    }
+    variants[variant_count].sheet = sheet;
+    variants[variant_count].frame_width = frame_width;
+    variants[variant_count].mirrored = mirrored;
+    variant_count++;
+    return mirrored;
+}
+
+// Box filter, one source row at a time: adds the byte totals of each
+// fx-pixel block of `row` to sums, bpp totals per output pixel. Working on
+// bytes means the channel layout doesn't matter.
+static void box_row_scalar(Uint32* sums, const Uint8* row, int out_w, int fx, int bpp) {
+    for (int ox = 0; ox < out_w; ox++) {
+        const Uint8* p = row + ox * fx * bpp;
+        Uint32* s = sums + ox * bpp;
+        for (int k = 0; k < fx * bpp; k += bpp) {
+            for (int b = 0; b < bpp; b++)
+                s[b] += p[k + b];
+        }
+    }
+}
+
+typedef void (*BoxRow32)(Uint32*, const Uint8*, int, int);
+
+static void box_row32_scalar(Uint32* sums, const Uint8* row, int out_w, int fx) {
+    box_row_scalar(sums, row, out_w, fx, 4);
+}
+
+#ifdef SPRITE_X86
+// Widens four pixels at a time to 16-bit lanes and sums them, two pixels
+// per register; the halves are folded once per block. A lane ends up with
+// a whole block's total for one channel, so fx must stay at or below 256.
+static void box_row32_sse2(Uint32* sums, const Uint8* row, int out_w, int fx) {
+    const __m128i zero = _mm_setzero_si128();
+    for (int ox = 0; ox < out_w; ox++) {
+        const Uint8* p = row + ox * fx * 4;
+        __m128i acc = zero;
+        int k = 0;
+        for (; k + 4 <= fx; k += 4) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(p + k * 4));
+            acc = _mm_add_epi16(acc, _mm_add_epi16(_mm_unpacklo_epi8(v, zero),
+                                                   _mm_unpackhi_epi8(v, zero)));
+        }
+        for (; k + 2 <= fx; k += 2)
+            acc = _mm_add_epi16(acc, _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(p + k * 4)), zero));
+        acc = _mm_add_epi16(acc, _mm_srli_si128(acc, 8));
+        if (k < fx) {
+            int last;
+            memcpy(&last, p + k * 4, 4);
+            acc = _mm_add_epi16(acc, _mm_unpacklo_epi8(_mm_cvtsi32_si128(last), zero));
+        }
+        __m128i* s = (__m128i*)(sums + ox * 4);
+        _mm_storeu_si128(s, _mm_add_epi32(_mm_loadu_si128(s), _mm_unpacklo_epi16(acc, zero)));
+    }
+}
+#endif
+
+static BoxRow32 pick_box_kernel(int fx) {
+#ifdef SPRITE_X86
+    if (fx <= 256) return box_row32_sse2;
+#endif
+    return box_row32_scalar;
+}
+
+// A new surface 1/fx the width and 1/fy the height of src, each pixel the
+// rounded mean of an fx x fy block. Leftover columns and rows that don't
+// fill a block are dropped. The caller owns the result.
+SDL_Surface* sprite_downsampled(SDL_Surface* src, int fx, int fy) {
+    if (!src || fx <= 0 || fy <= 0 || src->w < fx || src->h < fy) return NULL;
+    int out_w = src->w / fx, out_h = src->h / fy;
+    int bpp = src->format->BytesPerPixel, area = fx * fy;
+
+    SDL_PixelFormat* fmt = src->format;
+    SDL_Surface* dst = SDL_CreateRGBSurface(SDL_SWSURFACE, out_w, out_h, fmt->BitsPerPixel,
+                                            fmt->Rmask, fmt->Gmask, fmt->Bmask, fmt->Amask);
+    Uint32* sums = malloc((size_t)out_w * bpp * sizeof(Uint32));
+    if (!dst || !sums || fmt->palette) {   // Averaging palette indices means nothing
+        if (dst) SDL_FreeSurface(dst);
+        free(sums);
+        return NULL;
+    }
+    BoxRow32 box32 = (bpp == 4) ? pick_box_kernel(fx) : NULL;
+
+    SDL_LockSurface(src);
+    SDL_LockSurface(dst);
+    for (int oy = 0; oy < out_h; oy++) {
+        memset(sums, 0, (size_t)out_w * bpp * sizeof(Uint32));
+        for (int y = oy * fy; y < (oy + 1) * fy; y++) {
+            const Uint8* srow = (const Uint8*)src->pixels + y * src->pitch;
+            if (box32) box32(sums, srow, out_w, fx);
+            else box_row_scalar(sums, srow, out_w, fx, bpp);
+        }
+        Uint8* drow = (Uint8*)dst->pixels + oy * dst->pitch;
+        for (int i = 0; i < out_w * bpp; i++)
+            drow[i] = (Uint8)((sums[i] + area / 2) / area);
+    }
+    SDL_UnlockSurface(dst);
+    SDL_UnlockSurface(src);
+    free(sums);
+    return dst;
+}
+
+// A new w x h copy of src, each pixel the rounded mean of the source
+// pixels its area covers. Block edges are rounded to whole pixels, so it
+// suits shrinking small images such as icons; a block is never empty, so
+// growing works too. The caller owns the result.
+SDL_Surface* sprite_scaled(SDL_Surface* src, int w, int h) {
+    if (!src || w <= 0 || h <= 0) return NULL;
+    int bpp = src->format->BytesPerPixel;
+
+    SDL_PixelFormat* fmt = src->format;
+    if (fmt->palette) return NULL;
+    SDL_Surface* dst = SDL_CreateRGBSurface(SDL_SWSURFACE, w, h, fmt->BitsPerPixel,
+                                            fmt->Rmask, fmt->Gmask, fmt->Bmask, fmt->Amask);
+    if (!dst) return NULL;
+
+    SDL_LockSurface(src);
+    SDL_LockSurface(dst);
+    for (int oy = 0; oy < h; oy++) {
+        int y0 = oy * src->h / h, y1 = (oy + 1) * src->h / h;
+        if (y1 <= y0) y1 = y0 + 1;
+        Uint8* drow = (Uint8*)dst->pixels + oy * dst->pitch;
+        for (int ox = 0; ox < w; ox++) {
+            int x0 = ox * src->w / w, x1 = (ox + 1) * src->w / w;
+            if (x1 <= x0) x1 = x0 + 1;
+            Uint32 sums[4] = {0, 0, 0, 0};
+            for (int y = y0; y < y1; y++) {
+                const Uint8* srow = (const Uint8*)src->pixels + y * src->pitch;
+                box_row_scalar(sums, srow + x0 * bpp, 1, x1 - x0, bpp);
+            }
+            Uint32 area = (Uint32)(x1 - x0) * (y1 - y0);
+            for (int b = 0; b < bpp; b++)
+                drow[ox * bpp + b] = (Uint8)((sums[b] + area / 2) / area);
+        }
+    }
+    SDL_UnlockSurface(dst);
+    SDL_UnlockSurface(src);
+    if (src->flags & SDL_SRCALPHA)
+        SDL_SetAlpha(dst, src->flags & (SDL_SRCALPHA | SDL_RLEACCEL), fmt->alpha);
+    return dst;
+}
+
+void cleanup_sprites() {
+    for (int i = 0; i < variant_count; i++)
+        SDL_FreeSurface(variants[i].mirrored);
+    variant_count = 0;
+}
@@ -0,0 +1,13 @@
+#ifndef SPRITE_H
+#define SPRITE_H
+
+#include <SDL/SDL.h>
+
+#define SPRITE_VARIANT_CACHE 16   // Mirrored sheets kept for the whole run
+
+SDL_Surface* sprite_mirrored(SDL_Surface* sheet, int frame_width);
+SDL_Surface* sprite_downsampled(SDL_Surface* src, int fx, int fy);
+SDL_Surface* sprite_scaled(SDL_Surface* src, int w, int h);
+void cleanup_sprites();
+
+#endif
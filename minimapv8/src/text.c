@@ -0,0 +1,151 @@
+#include "text.h"
+#include "dirty.h"
+#include <stdio.h>
+#include <string.h>
+
+typedef struct {
+    TTF_Font*    font;
+    char         text[TEXT_MAX_LEN];
+    SDL_Surface* surface;
+} CachedText;
+
+static CachedText text_cache[TEXT_CACHE_SIZE];
+static int        text_cache_count = 0;
+
+// Glyph atlas for strings that change every frame (score and the like)
+static SDL_Surface* atlas = NULL;
+static SDL_Rect     glyph_rect[GLYPH_LAST - GLYPH_FIRST + 1];
+static int          glyph_advance[GLYPH_LAST - GLYPH_FIRST + 1];
+static int          atlas_height = 0;
+static TTF_Font*    atlas_font = NULL;
+
+static const SDL_Color white = {255,255,255,255};
+
+void init_text(TTF_Font* font) {
+    SDL_Surface* glyphs[GLYPH_LAST - GLYPH_FIRST + 1];
+    int width = 0;
+
+    atlas_font = font;
+    // Each glyph is rendered as a one-character string so it keeps the same
+    // baseline placement as a full TTF_RenderText_Blended line.
+    for (int c = GLYPH_FIRST; c <= GLYPH_LAST; c++) {
+        int i = c - GLYPH_FIRST;
+        char s[2] = {(char)c, '\0'};
+        int minx, maxx, miny, maxy;
+        if (TTF_GlyphMetrics(font, (Uint16)c, &minx, &maxx, &miny, &maxy, &glyph_advance[i]) == -1)
+            glyph_advance[i] = 0;
+        glyphs[i] = TTF_RenderText_Blended(font, s, white);
+        if (glyphs[i]) {
+            width += glyphs[i]->w;
+            if (glyphs[i]->h > atlas_height) atlas_height = glyphs[i]->h;
+        }
+    }
+
+    SDL_Surface* sample = NULL;
+    for (int i = 0; i <= GLYPH_LAST - GLYPH_FIRST && !sample; i++)
+        sample = glyphs[i];
+
+    if (sample && width > 0) {
+        SDL_PixelFormat* fmt = sample->format;
+        atlas = SDL_CreateRGBSurface(SDL_SWSURFACE, width, atlas_height, 32,
+                                     fmt->Rmask, fmt->Gmask, fmt->Bmask, fmt->Amask);
+    }
+    if (!atlas) fprintf(stderr, "Failed to build glyph atlas, using slow text path\n");
+
+    int x = 0;
+    for (int i = 0; i <= GLYPH_LAST - GLYPH_FIRST; i++) {
+        glyph_rect[i].x = glyph_rect[i].y = 0;
+        glyph_rect[i].w = glyph_rect[i].h = 0;
+        if (!glyphs[i]) continue;
+        if (atlas) {
+            // Copy the coverage as-is instead of blending it onto the atlas
+            SDL_SetAlpha(glyphs[i], 0, 0);
+            SDL_Rect dst = {x, 0, glyphs[i]->w, glyphs[i]->h};
+            SDL_BlitSurface(glyphs[i], NULL, atlas, &dst);
+            glyph_rect[i].x = x;
+            glyph_rect[i].w = glyphs[i]->w;
+            glyph_rect[i].h = glyphs[i]->h;
+            x += glyphs[i]->w;
+        }
+        SDL_FreeSurface(glyphs[i]);
+    }
+    if (atlas) SDL_SetAlpha(atlas, SDL_SRCALPHA, SDL_ALPHA_OPAQUE);
+}
+
+void cleanup_text() {
+    for (int i = 0; i < text_cache_count; i++)
+        SDL_FreeSurface(text_cache[i].surface);
+    text_cache_count = 0;
+    if (atlas) SDL_FreeSurface(atlas);
+    atlas = NULL;
+}
+
+static SDL_Surface* cached_text(TTF_Font* font, const char* text) {
+    for (int i = 0; i < text_cache_count; i++) {
+        if (text_cache[i].font == font && strcmp(text_cache[i].text, text) == 0)
+            return text_cache[i].surface;
+    }
+    if (text_cache_count == TEXT_CACHE_SIZE || strlen(text) >= TEXT_MAX_LEN)
+        return NULL;
+
+    SDL_Surface* ts = TTF_RenderText_Blended(font, text, white);
+    if (!ts) return NULL;
+    CachedText* entry = &text_cache[text_cache_count++];
+    entry->font = font;
+    strcpy(entry->text, text);
+    entry->surface = ts;
+    return ts;
+}
+
+// For strings that stay the same from frame to frame: rendered once, then
+// blitted from the cache.
+void render_text(SDL_Surface* screen, TTF_Font* font, const char* text, int x, int y) {
+    SDL_Surface* ts = cached_text(font, text);
+    if (ts) {
+        SDL_Rect dst = {x,y,ts->w,ts->h};
+        SDL_BlitSurface(ts, NULL, screen, &dst);
+        dirty_mark(dst);
+        return;
+    }
+
+    // Cache full: fall back to rendering this string on the spot
+    ts = TTF_RenderText_Blended(font, text, white);
+    if (ts) {
+        SDL_Rect dst = {x,y,ts->w,ts->h};
+        SDL_BlitSurface(ts, NULL, screen, &dst);
+        dirty_mark(dst);
+        SDL_FreeSurface(ts);
+    }
+}
+
+// For strings that change often: assembled from the glyph atlas, so nothing
+// is rasterized or allocated per call. No kerning is applied.
+void render_text_dynamic(SDL_Surface* screen, const char* text, int x, int y) {
+    if (!atlas) {
+        SDL_Surface* ts = TTF_RenderText_Blended(atlas_font, text, white);
+        if (ts) {
+            SDL_Rect dst = {x,y,ts->w,ts->h};
+            SDL_BlitSurface(ts, NULL, screen, &dst);
+            dirty_mark(dst);
+            SDL_FreeSurface(ts);
+        }
+        return;
+    }
+
+    int pen = x, right = x;
+    for (const char* p = text; *p; p++) {
+        int c = (unsigned char)*p;
+        if (c < GLYPH_FIRST || c > GLYPH_LAST) continue;
+        int i = c - GLYPH_FIRST;
+        if (glyph_rect[i].w > 0) {
+            SDL_Rect src = glyph_rect[i];
+            SDL_Rect dst = {pen, y, src.w, src.h};
+            SDL_BlitSurface(atlas, &src, screen, &dst);
+            if (pen + src.w > right) right = pen + src.w;
+        }
+        pen += glyph_advance[i];
+    }
+
+    SDL_Rect area = {x, y, right - x, atlas_height};
+    dirty_mark(area);
+}
@@ -0,0 +1,17 @@
+#ifndef TEXT_H
+#define TEXT_H
+
+#include <SDL/SDL.h>
+#include <SDL/SDL_ttf.h>
+
+#define TEXT_CACHE_SIZE 16    // Distinct static strings kept rendered
+#define TEXT_MAX_LEN    64
+#define GLYPH_FIRST     32    // Printable ASCII range held in the atlas
+#define GLYPH_LAST      126
+
+void init_text(TTF_Font* font);
+void cleanup_text();
+void render_text(SDL_Surface* screen, TTF_Font* font, const char* text, int x, int y);
+void render_text_dynamic(SDL_Surface* screen, const char* text, int x, int y);
+
+#endif
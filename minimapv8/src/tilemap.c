@@ -0,0 +1,254 @@
+#include "tilemap.h"
+#include "game.h"
+#include <stdio.h>
+
+typedef struct {
+    int          level;       // -1 while the slot is free
+    int          cx, cy;      // Position in chunks
+    SDL_Surface* surface;
+    Uint32       last_used;   // Value of use_clock when last drawn or streamed
+} Chunk;
+
+static SDL_Surface*  tileset = NULL;   // Points into the pack mapping
+static Chunk         chunks[MAX_CHUNKS];
+static const Uint16* map = NULL;
+static int           map_level = -1;
+static int           map_cols, map_rows, map_pitch;
+
+static size_t budget         = (size_t)CHUNK_BUDGET_KB * 1024;
+static size_t resident_bytes = 0;
+static Uint32 use_clock      = 0;
+static int    view_x0, view_x1;        // Chunk columns the camera needs now
+static int    built = 0, evictions = 0;
+static size_t peak_bytes = 0;
+
+// Returns 0 when the archive has no tileset; levels then come from the
+// composed backgrounds in the loader.
+int init_tilemap() {
+    tileset = pack_surface(PACK_TILESET_NAME);
+    if (!tileset) return 0;
+    for (int i = 0; i < MAX_CHUNKS; i++) chunks[i].level = -1;
+    return 1;
+}
+
+static size_t chunk_bytes(SDL_Surface* s) {
+    return (size_t)s->pitch * s->h;
+}
+
+static void free_chunk(Chunk* c) {
+    resident_bytes -= chunk_bytes(c->surface);
+    SDL_FreeSurface(c->surface);
+    c->surface = NULL;
+    c->level = -1;
+}
+
+void cleanup_tilemap() {
+    if (!tileset) return;
+    tilemap_report();
+    for (int i = 0; i < MAX_CHUNKS; i++) {
+        if (chunks[i].level >= 0) free_chunk(&chunks[i]);
+    }
+    SDL_FreeSurface(tileset);
+    tileset = NULL;
+    map = NULL;
+    map_level = -1;
+}
+
+static int in_view(const Chunk* c) {
+    return c->level == map_level && c->cx >= view_x0 && c->cx <= view_x1;
+}
+
+// Frees least recently used chunks until `incoming` more bytes fit the
+// budget. Chunks the camera needs are never evicted; if they alone fill the
+// budget, the caller has to do without a new chunk.
+static int evict_to_budget(size_t incoming) {
+    while (resident_bytes + incoming > budget) {
+        Chunk* victim = NULL;
+        for (int i = 0; i < MAX_CHUNKS; i++) {
+            Chunk* c = &chunks[i];
+            if (c->level >= 0 && !in_view(c) && (!victim || c->last_used < victim->last_used))
+                victim = c;
+        }
+        if (!victim) return 0;
+        free_chunk(victim);
+        evictions++;
+    }
+    return 1;
+}
+
+void tilemap_set_budget(size_t bytes) {
+    budget = bytes;
+    evict_to_budget(0);   // Chunks in view stay until the camera moves on
+}
+
+// Switches to a level's grid. Chunks of other levels stay cached until
+// the budget needs their room. Returns 0 if the archive has no grid.
+int tilemap_load(int level) {
+    char name[PACK_NAME_LEN];
+    snprintf(name, sizeof(name), PACK_MAP_NAME, level + 1);
+    const Uint16* grid = pack_tilemap(name, &map_cols, &map_rows, &map_pitch);
+    if (!grid) {
+        fprintf(stderr, "No tile map for level %d in %s\n", level + 1, PACK_PATH);
+        return 0;
+    }
+    map = grid;
+    map_level = level;
+    return 1;
+}
+
+static void blit_tile(int tile, SDL_Surface* dst, int x, int y) {
+    SDL_Rect src = {(Sint16)(tile % TILESET_COLS * TILE_SIZE),
+                    (Sint16)(tile / TILESET_COLS * TILE_SIZE), TILE_SIZE, TILE_SIZE};
+    SDL_Rect pos = {(Sint16)x, (Sint16)y, TILE_SIZE, TILE_SIZE};
+    SDL_BlitSurface(tileset, &src, dst, &pos);
+}
+
+// Composes a chunk into the cache. NULL if the budget has no room for it
+// even after evicting everything off screen; it is then drawn tile by tile.
+static Chunk* build_chunk(int cx, int cy) {
+    SDL_PixelFormat* fmt = game.screen->format;
+    if (!evict_to_budget((size_t)CHUNK_SIZE * CHUNK_SIZE * fmt->BytesPerPixel)) return NULL;
+
+    SDL_Surface* s = SDL_CreateRGBSurface(SDL_SWSURFACE, CHUNK_SIZE, CHUNK_SIZE, fmt->BitsPerPixel,
+                                          fmt->Rmask, fmt->Gmask, fmt->Bmask, 0);
+    if (!s) {
+        fprintf(stderr, "Failed to create tile chunk: %s\n", SDL_GetError());
+        return NULL;
+    }
+
+    Chunk* slot = NULL;
+    for (int i = 0; i < MAX_CHUNKS && !slot; i++) {
+        if (chunks[i].level < 0) slot = &chunks[i];
+    }
+    if (!slot) {
+        // Out of slots: take the oldest chunk off screen whatever the budget
+        for (int i = 0; i < MAX_CHUNKS; i++) {
+            if (!in_view(&chunks[i]) && (!slot || chunks[i].last_used < slot->last_used))
+                slot = &chunks[i];
+        }
+        if (!slot) {
+            SDL_FreeSurface(s);
+            return NULL;
+        }
+        free_chunk(slot);
+        evictions++;
+    }
+
+    for (int ty = 0; ty < CHUNK_TILES; ty++) {
+        int row = cy * CHUNK_TILES + ty;
+        if (row >= map_rows) break;
+        for (int tx = 0; tx < CHUNK_TILES; tx++) {
+            int col = cx * CHUNK_TILES + tx;
+            if (col >= map_cols) break;
+            blit_tile(map[row * map_pitch + col], s, tx * TILE_SIZE, ty * TILE_SIZE);
+        }
+    }
+
+    slot->level = map_level;
+    slot->cx = cx;
+    slot->cy = cy;
+    slot->surface = s;
+    slot->last_used = ++use_clock;
+    resident_bytes += chunk_bytes(s);
+    if (resident_bytes > peak_bytes) peak_bytes = resident_bytes;
+    built++;
+    return slot;
+}
+
+static Chunk* get_chunk(int cx, int cy) {
+    for (int i = 0; i < MAX_CHUNKS; i++) {
+        Chunk* c = &chunks[i];
+        if (c->level == map_level && c->cx == cx && c->cy == cy) {
+            c->last_used = ++use_clock;
+            return c;
+        }
+    }
+    return build_chunk(cx, cy);
+}
+
+// Makes sure every chunk the camera at view_x shows, plus a margin in the
+// direction it may scroll, is composed before drawing starts.
+void tilemap_stream(int view_x) {
+    if (!map) return;
+    int cols = (map_cols + CHUNK_TILES - 1) / CHUNK_TILES;
+    int rows = (map_rows + CHUNK_TILES - 1) / CHUNK_TILES;
+    view_x0 = view_x / CHUNK_SIZE - CHUNK_STREAM_MARGIN;
+    view_x1 = (view_x + SCREEN_WIDTH - 1) / CHUNK_SIZE + CHUNK_STREAM_MARGIN;
+    if (view_x0 < 0) view_x0 = 0;
+    if (view_x1 >= cols) view_x1 = cols - 1;
+    for (int cx = view_x0; cx <= view_x1; cx++) {
+        for (int cy = 0; cy < rows; cy++)
+            get_chunk(cx, cy);
+    }
+}
+
+// Blits the world rect [x0,x1) x [y0,y1) straight from the tileset, for
+// chunks the budget has no room for
+static void draw_tiles(SDL_Surface* screen, int x0, int y0, int x1, int y1, int view_x) {
+    for (int row = y0 / TILE_SIZE; row * TILE_SIZE < y1 && row < map_rows; row++) {
+        for (int col = x0 / TILE_SIZE; col * TILE_SIZE < x1 && col < map_cols; col++) {
+            int left = col * TILE_SIZE, top = row * TILE_SIZE;
+            int sx0 = x0 > left ? x0 : left, sx1 = x1 < left + TILE_SIZE ? x1 : left + TILE_SIZE;
+            int sy0 = y0 > top ? y0 : top, sy1 = y1 < top + TILE_SIZE ? y1 : top + TILE_SIZE;
+            int tile = map[row * map_pitch + col];
+            SDL_Rect src = {(Sint16)(tile % TILESET_COLS * TILE_SIZE + sx0 - left),
+                            (Sint16)(tile / TILESET_COLS * TILE_SIZE + sy0 - top),
+                            (Uint16)(sx1 - sx0), (Uint16)(sy1 - sy0)};
+            SDL_Rect dst = {(Sint16)(sx0 - view_x), (Sint16)sy0, 0, 0};
+            SDL_BlitSurface(tileset, &src, screen, &dst);
+        }
+    }
+}
+
+// Fills screen rect r with the level seen from view_x
+void tilemap_draw(SDL_Surface* screen, SDL_Rect r, int view_x) {
+    if (!map) return;
+    int x0 = r.x + view_x, x1 = x0 + r.w;
+    int y0 = r.y, y1 = y0 + r.h;
+    for (int cy = y0 / CHUNK_SIZE; cy * CHUNK_SIZE < y1; cy++) {
+        for (int cx = x0 / CHUNK_SIZE; cx * CHUNK_SIZE < x1; cx++) {
+            Chunk* c = get_chunk(cx, cy);
+            int left = cx * CHUNK_SIZE, top = cy * CHUNK_SIZE;
+            int sx0 = x0 > left ? x0 : left, sx1 = x1 < left + CHUNK_SIZE ? x1 : left + CHUNK_SIZE;
+            int sy0 = y0 > top ? y0 : top, sy1 = y1 < top + CHUNK_SIZE ? y1 : top + CHUNK_SIZE;
+            if (!c) {
+                draw_tiles(screen, sx0, sy0, sx1, sy1, view_x);
+                continue;
+            }
+            SDL_Rect src = {(Sint16)(sx0 - left), (Sint16)(sy0 - top), (Uint16)(sx1 - sx0), (Uint16)(sy1 - sy0)};
+            SDL_Rect dst = {(Sint16)(sx0 - view_x), (Sint16)sy0, 0, 0};
+            SDL_BlitSurface(c->surface, &src, screen, &dst);
+        }
+    }
+}
+
+// A whole level laid out in one display-format surface, for one-off work
+// such as building its minimap. Bypasses the chunk cache. NULL if the
+// level has no grid.
+SDL_Surface* tilemap_compose(int level) {
+    char name[PACK_NAME_LEN];
+    int cols, rows, pitch;
+    snprintf(name, sizeof(name), PACK_MAP_NAME, level + 1);
+    const Uint16* grid = tileset ? pack_tilemap(name, &cols, &rows, &pitch) : NULL;
+    if (!grid) return NULL;
+
+    SDL_PixelFormat* fmt = game.screen->format;
+    SDL_Surface* s = SDL_CreateRGBSurface(SDL_SWSURFACE, cols * TILE_SIZE, rows * TILE_SIZE,
+                                          fmt->BitsPerPixel, fmt->Rmask, fmt->Gmask, fmt->Bmask, 0);
+    if (!s) return NULL;
+    for (int row = 0; row < rows; row++) {
+        for (int col = 0; col < cols; col++)
+            blit_tile(grid[row * pitch + col], s, col * TILE_SIZE, row * TILE_SIZE);
+    }
+    return s;
+}
+
+void tilemap_report() {
+    int count = 0;
+    for (int i = 0; i < MAX_CHUNKS; i++) {
+        if (chunks[i].level >= 0) count++;
+    }
+    printf("Tile chunks: %d resident, %lu KB of %lu KB budget (peak %lu KB), %d built, %d evictions\n",
+           count, (unsigned long)(resident_bytes / 1024), (unsigned long)(budget / 1024),
+           (unsigned long)(peak_bytes / 1024), built, evictions);
+}
@@ -0,0 +1,26 @@
+#ifndef TILEMAP_H
+#define TILEMAP_H
+
+#include <SDL/SDL.h>
+#include "pack.h"
+
+// Level backgrounds drawn from the packed tileset. Tiles are composed into
+// small chunk surfaces as the camera reaches them and evicted, least
+// recently used first, once the chunks go over a fixed budget, so memory
+// follows the view rather than the size or number of levels.
+#define CHUNK_TILES          2     // Chunks are CHUNK_TILES x CHUNK_TILES tiles
+#define CHUNK_SIZE           (TILE_SIZE * CHUNK_TILES)
+#define MAX_CHUNKS           256
+#define CHUNK_BUDGET_KB      1024  // Default, under one composed 800x600 level (1875 KB)
+#define CHUNK_STREAM_MARGIN  1     // Chunk columns built ahead of the camera
+
+int  init_tilemap();
+void cleanup_tilemap();
+void tilemap_set_budget(size_t bytes);
+int  tilemap_load(int level);
+void tilemap_stream(int view_x);
+void tilemap_draw(SDL_Surface* screen, SDL_Rect r, int view_x);
+SDL_Surface* tilemap_compose(int level);
+void tilemap_report();
+
+#endif
@@ -0,0 +1,316 @@
+// Offline asset packer: decodes every sprite, composes every level
+// background and cuts it into tiles shared across levels, then writes them
+// to assets/assets.pak in the layout described in src/pack.h. Run from the
+// game directory:
+//
+//   ./tools/packer [output]
+#include "../src/pack.h"
+#include "../src/game.h"
+#include <SDL/SDL.h>
+#include <SDL/SDL_image.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_ASSETS 32
+#define MAX_TILES  8192
+#define TILE_HASH_SIZE 16384   // Power of two, at least twice MAX_TILES
+#define TILE_PIXELS (TILE_SIZE * TILE_SIZE)
+#define MAP_COLS   (WORLD_WIDTH / TILE_SIZE)
+#define MAP_ROWS   (SCREEN_HEIGHT / TILE_SIZE)
+
+typedef struct {
+    const char* path;
+    int         keyed;      // Key colour becomes transparent (ARGB entry)
+    Uint8       r, g, b;
+} SpriteSpec;
+
+// Keep in sync with the load_image()/load_image_keyed_alpha() calls
+static const SpriteSpec sprites[] = {
+    {"assets/player.png",           0, 0, 0, 0},
+    {"assets/platform.png",         0, 0, 0, 0},
+    {"assets/coin.png",             1, 0, 0, 0},
+    {"assets/obstacle.jpg",         0, 0, 0, 0},
+    {"assets/minimap_player.jpg",   0, 0, 0, 0},
+    {"assets/minimap_platform.png", 0, 0, 0, 0},
+    {"assets/minimap_coin.png",     0, 0, 0, 0},
+};
+
+static PackEntry    entries[MAX_ASSETS];
+static SDL_Surface* surfaces[MAX_ASSETS];
+static Uint16*      grids[MAX_ASSETS];    // Tile maps, written instead of a surface
+static int          count = 0;
+
+static Uint32* tiles = NULL;              // MAX_TILES x TILE_PIXELS, XRGB
+static int     tile_count = 0;
+static int     tile_hash[TILE_HASH_SIZE]; // Tile index + 1, 0 when empty
+
+static SDL_PixelFormat* xrgb = NULL;
+static SDL_PixelFormat* argb = NULL;
+
+static PackEntry* new_entry(const char* name, int width, int height, int cell_bytes, Uint32 flags) {
+    if (count == MAX_ASSETS) {
+        fprintf(stderr, "Too many assets, raise MAX_ASSETS\n");
+        exit(1);
+    }
+    PackEntry* e = &entries[count];
+    memset(e, 0, sizeof(*e));
+    strncpy(e->name, name, PACK_NAME_LEN - 1);
+    e->width  = width;
+    e->height = height;
+    e->pitch  = (width * cell_bytes + PACK_ALIGN - 1) & ~(PACK_ALIGN - 1);
+    e->flags  = flags;
+    surfaces[count] = NULL;
+    grids[count] = NULL;
+    return e;
+}
+
+// FNV-1a over the bytes of every row, without the padding
+static Uint32 hash_surface(SDL_Surface* s) {
+    Uint32 h = 2166136261u;
+    SDL_LockSurface(s);
+    for (int y = 0; y < s->h; y++) {
+        const Uint8* row = (const Uint8*)s->pixels + y * s->pitch;
+        for (int i = 0; i < s->w * 4; i++) {
+            h ^= row[i];
+            h *= 16777619u;
+        }
+    }
+    SDL_UnlockSurface(s);
+    return h;
+}
+
+static void add_entry(const char* name, SDL_Surface* s, Uint32 flags) {
+    new_entry(name, s->w, s->h, 4, flags)->hash = hash_surface(s);
+    surfaces[count++] = s;
+}
+
+// `hash` is that of the pixels the grid lays out
+static void add_grid(const char* name, Uint16* cells, int cols, int rows, Uint32 hash) {
+    new_entry(name, cols, rows, sizeof(Uint16), PACK_TILEMAP)->hash = hash;
+    grids[count++] = cells;
+}
+
+static SDL_Surface* load(const char* path) {
+    SDL_Surface* s = IMG_Load(path);
+    if (!s) {
+        fprintf(stderr, "Failed to load %s: %s\n", path, IMG_GetError());
+        exit(1);
+    }
+    return s;
+}
+
+static void pack_sprite(const SpriteSpec* spec) {
+    SDL_Surface* raw = load(spec->path);
+    SDL_Surface* s;
+    if (spec->keyed) {
+        // Same conversion SDL_DisplayFormatAlpha does for a colorkeyed image
+        SDL_SetColorKey(raw, SDL_SRCCOLORKEY, SDL_MapRGB(raw->format, spec->r, spec->g, spec->b));
+        s = SDL_ConvertSurface(raw, argb, SDL_SWSURFACE);
+    } else {
+        s = SDL_ConvertSurface(raw, xrgb, SDL_SWSURFACE);
+    }
+    SDL_FreeSurface(raw);
+    if (!s) {
+        fprintf(stderr, "Failed to convert %s: %s\n", spec->path, SDL_GetError());
+        exit(1);
+    }
+    add_entry(spec->path, s, spec->keyed ? PACK_ALPHA : 0);
+}
+
+static Uint32 hash_tile(const Uint32* px) {
+    Uint32 h = 2166136261u;   // FNV-1a over the pixels
+    for (int i = 0; i < TILE_PIXELS; i++) {
+        h ^= px[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Index of the tile with these pixels, adding it if it is new
+static int intern_tile(const Uint32* px) {
+    Uint32 slot = hash_tile(px) & (TILE_HASH_SIZE - 1);
+    while (tile_hash[slot]) {
+        int i = tile_hash[slot] - 1;
+        if (memcmp(tiles + (size_t)i * TILE_PIXELS, px, TILE_PIXELS * 4) == 0) return i;
+        slot = (slot + 1) & (TILE_HASH_SIZE - 1);
+    }
+    if (tile_count == MAX_TILES) {
+        fprintf(stderr, "Too many distinct tiles, raise MAX_TILES\n");
+        exit(1);
+    }
+    memcpy(tiles + (size_t)tile_count * TILE_PIXELS, px, TILE_PIXELS * 4);
+    tile_hash[slot] = tile_count + 1;
+    return tile_count++;
+}
+
+// Cuts a composed screen into tiles and lays them out across the level's
+// world, repeating the screen as the game used to scroll it
+static void tile_level(int level, SDL_Surface* composed) {
+    const int screen_cols = SCREEN_WIDTH / TILE_SIZE;
+    int screen_tiles[SCREEN_WIDTH / TILE_SIZE * MAP_ROWS];
+    Uint32 px[TILE_PIXELS];
+
+    SDL_LockSurface(composed);
+    for (int ty = 0; ty < MAP_ROWS; ty++) {
+        for (int tx = 0; tx < screen_cols; tx++) {
+            for (int y = 0; y < TILE_SIZE; y++) {
+                const Uint8* row = (Uint8*)composed->pixels + (ty * TILE_SIZE + y) * composed->pitch;
+                memcpy(px + y * TILE_SIZE, row + tx * TILE_SIZE * 4, TILE_SIZE * 4);
+            }
+            screen_tiles[ty * screen_cols + tx] = intern_tile(px);
+        }
+    }
+    SDL_UnlockSurface(composed);
+
+    Uint16* grid = malloc(MAP_COLS * MAP_ROWS * sizeof(Uint16));
+    if (!grid) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+    for (int ty = 0; ty < MAP_ROWS; ty++) {
+        for (int tx = 0; tx < MAP_COLS; tx++)
+            grid[ty * MAP_COLS + tx] = (Uint16)screen_tiles[ty * screen_cols + tx % screen_cols];
+    }
+
+    char name[PACK_NAME_LEN];
+    snprintf(name, sizeof(name), PACK_MAP_NAME, level + 1);
+    add_grid(name, grid, MAP_COLS, MAP_ROWS, hash_surface(composed));
+}
+
+static void add_tileset() {
+    int rows = (tile_count + TILESET_COLS - 1) / TILESET_COLS;
+    SDL_Surface* s = SDL_CreateRGBSurface(SDL_SWSURFACE, TILESET_COLS * TILE_SIZE, rows * TILE_SIZE, 32,
+                                          PACK_RMASK, PACK_GMASK, PACK_BMASK, 0);
+    if (!s) {
+        fprintf(stderr, "Failed to create tileset surface: %s\n", SDL_GetError());
+        exit(1);
+    }
+    SDL_LockSurface(s);
+    for (int i = 0; i < tile_count; i++) {
+        int x = i % TILESET_COLS * TILE_SIZE, y = i / TILESET_COLS * TILE_SIZE;
+        for (int r = 0; r < TILE_SIZE; r++)
+            memcpy((Uint8*)s->pixels + (y + r) * s->pitch + x * 4,
+                   tiles + (size_t)i * TILE_PIXELS + r * TILE_SIZE, TILE_SIZE * 4);
+    }
+    SDL_UnlockSurface(s);
+    add_entry(PACK_TILESET_NAME, s, 0);
+}
+
+// Mirrors compose_level() in game.c
+static void pack_level(int level) {
+    const char* layers[3] = {"assets/sky%d.jpg", "assets/city%d.png", "assets/ground%d.png"};
+    const int   layer_y[3] = {0, 0, GROUND_LEVEL};
+
+    SDL_Surface* composed = SDL_CreateRGBSurface(SDL_SWSURFACE, SCREEN_WIDTH, SCREEN_HEIGHT, 32,
+                                                 PACK_RMASK, PACK_GMASK, PACK_BMASK, 0);
+    if (!composed) {
+        fprintf(stderr, "Failed to create level surface: %s\n", SDL_GetError());
+        exit(1);
+    }
+    for (int i = 0; i < 3; i++) {
+        char path[64];
+        snprintf(path, sizeof(path), layers[i], level + 1);
+        SDL_Surface* layer = load(path);
+        SDL_SetAlpha(layer, 0, 0);
+        SDL_Rect pos = {0, layer_y[i], layer->w, layer->h};
+        SDL_BlitSurface(layer, NULL, composed, &pos);
+        SDL_FreeSurface(layer);
+    }
+
+    tile_level(level, composed);
+    SDL_FreeSurface(composed);
+}
+
+int main(int argc, char* argv[]) {
+    const char* out_path = argc > 1 ? argv[1] : PACK_PATH;
+
+    if (SDL_Init(0) < 0) {
+        fprintf(stderr, "SDL_Init: %s\n", SDL_GetError());
+        return 1;
+    }
+    IMG_Init(IMG_INIT_JPG | IMG_INIT_PNG);
+
+    SDL_Surface* fx = SDL_CreateRGBSurface(SDL_SWSURFACE, 1, 1, 32, PACK_RMASK, PACK_GMASK, PACK_BMASK, 0);
+    SDL_Surface* fa = SDL_CreateRGBSurface(SDL_SWSURFACE, 1, 1, 32, PACK_RMASK, PACK_GMASK, PACK_BMASK, PACK_AMASK);
+    if (!fx || !fa) {
+        fprintf(stderr, "SDL_CreateRGBSurface: %s\n", SDL_GetError());
+        return 1;
+    }
+    xrgb = fx->format;
+    argb = fa->format;
+
+    for (size_t i = 0; i < sizeof(sprites) / sizeof(sprites[0]); i++)
+        pack_sprite(&sprites[i]);
+    tiles = malloc((size_t)MAX_TILES * TILE_PIXELS * 4);
+    if (!tiles) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    for (int level = 0; level < MAX_LEVELS; level++)
+        pack_level(level);
+    add_tileset();
+    free(tiles);
+    printf("%d level tiles, %d distinct\n", MAX_LEVELS * (SCREEN_WIDTH / TILE_SIZE) * MAP_ROWS, tile_count);
+
+    Uint32 offset = sizeof(PackHeader) + count * sizeof(PackEntry);
+    for (int i = 0; i < count; i++) {
+        offset = (offset + PACK_ALIGN - 1) & ~(PACK_ALIGN - 1);
+        entries[i].offset = offset;
+        offset += entries[i].pitch * entries[i].height;
+    }
+
+    char tmp_path[256];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", out_path);
+    FILE* f = fopen(tmp_path, "wb");
+    if (!f) {
+        fprintf(stderr, "Cannot write %s\n", tmp_path);
+        return 1;
+    }
+
+    PackHeader header;
+    memcpy(header.magic, PACK_MAGIC, 4);
+    header.version = PACK_VERSION;
+    header.count = count;
+    header.byte_order = 0x01020304;
+    fwrite(&header, sizeof(header), 1, f);
+    fwrite(entries, sizeof(PackEntry), count, f);
+
+    static const Uint8 zeros[PACK_ALIGN] = {0};
+    long pos = ftell(f);
+    for (int i = 0; i < count; i++) {
+        fwrite(zeros, 1, entries[i].offset - pos, f);
+        if (grids[i]) {
+            Uint32 w = entries[i].width;
+            for (Uint32 y = 0; y < entries[i].height; y++) {
+                fwrite(grids[i] + y * w, sizeof(Uint16), w, f);
+                fwrite(zeros, 1, entries[i].pitch - w * sizeof(Uint16), f);
+            }
+            free(grids[i]);
+        } else {
+            SDL_Surface* s = surfaces[i];
+            SDL_LockSurface(s);
+            for (int y = 0; y < s->h; y++) {
+                fwrite((Uint8*)s->pixels + y * s->pitch, 4, s->w, f);
+                fwrite(zeros, 1, entries[i].pitch - s->w * 4, f);
+            }
+            SDL_UnlockSurface(s);
+            SDL_FreeSurface(s);
+        }
+        pos = entries[i].offset + entries[i].pitch * entries[i].height;
+        printf("%-28s %4ux%-4u %s\n", entries[i].name, (unsigned)entries[i].width,
+               (unsigned)entries[i].height, (entries[i].flags & PACK_TILEMAP) ? "MAP" : (entries[i].flags & PACK_ALPHA) ? "ARGB" : "XRGB");
+    }
+
+    if (fclose(f) != 0 || rename(tmp_path, out_path) != 0) {
+        fprintf(stderr, "Failed to write %s\n", out_path);
+        return 1;
+    }
+    printf("Wrote %s: %d assets, %lu bytes\n", out_path, count, (unsigned long)pos);
+
+    SDL_FreeSurface(fx);
+    SDL_FreeSurface(fa);
+    IMG_Quit();
+    SDL_Quit();
+    return 0;
+}